@@ -12,6 +12,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "sensorimotor_node.hpp"
+#include "sequencer.hpp"
 
 /*
 	+-------+-------+------------------------------------------+
@@ -28,6 +29,34 @@
 	| bit  |     7 |     6 |     5 |     4 |     3 |     2 |     1 |     0 |
 	| name | REFS1 | REFS0 | ADLAR |       |  MUX3 |  MUX2 |  MUX1 |  MUX0 |
 	+------+-------+-------+-------+-------+-------+-------+-------+-------+
+
+	The ADC runs continuously, driven by its ISR, which restarts the next
+	conversion right away. Each channel accumulates 16 samples which are
+	decimated to one 12 bit result (oversampling by 4^n adds n bits).
+	The main loop just reads the latest results and never waits.
+
+	The channel order is a compile-time schedule in flash, see
+	sequencer.hpp. The potis are sampled 4x as often as the brightness
+	sensors: 18 conversions of 52µs (13 cycles at 250kHz ADC clock) per
+	schedule, so the potis are updated every ~3.7ms, the brightness every
+	~15ms (update_period_us()). A result is the mean over this period,
+	i.e. it lags the input by about half of it. 250kHz is above the
+	200kHz given for full 10 bit resolution, the loss is in the lowest
+	bit, which the 16x oversampling averages out. At 500kHz the errors
+	grow faster than the oversampling gains.
+
+	ISR load: one ADC_vect per 52µs (832 cycles). Its accumulate and
+	decimate path is roughly 60..90 cycles incl. entry and exit (hand
+	count, not measured), about 10% of the CPU (5% at 125kHz).
+	It delays the RX ISR by at most its own length, well within a byte.
+
+	Reading the results: use get_snapshot(), not result[] directly. The
+	16 bit results are written by the ISR, an unprotected read could be
+	torn in the middle. Instead of blocking interrupts (which would
+	delay the UART RX ISR) a sequence counter is used: the ISR bumps it
+	after every update, the reader copies all channels and retries if
+	the counter changed meanwhile. Since the ISR cannot be interrupted
+	by the reader, a single increment suffices (no odd/even state).
 */
 
 namespace supreme {
@@ -41,65 +70,97 @@ namespace adc {
 	const uint8_t brgt_0 = adc_channel::brgt_0;
 	const uint8_t brgt_1 = adc_channel::brgt_1;
 
-	const uint8_t first = poti_0;
+	typedef sequencer< channel<poti_0, 4>
+	                 , channel<poti_1, 4>
+	                 , channel<poti_2, 4>
+	                 , channel<poti_3, 4>
+	                 , channel<brgt_0, 1>
+	                 , channel<brgt_1, 1> > schedule;
+
+	const uint8_t  prescaler     = 64;  /* 16MHz / 64 = 250kHz ADC clock */
+	const uint16_t conversion_us = 13 * prescaler / (F_CPU / 1000000UL);
 
-	uint8_t next[8];
+	const uint8_t oversampling     = 16;
+	const uint8_t decimation_shift = 2;  /* 16 x 10 bit = 14 bit sum -> 12 bit */
+	const uint8_t resolution       = 12; /* bits */
 
 	/* registers changed by isr */
-	volatile uint16_t result[8];
-	volatile uint8_t  channel = first;
-	volatile bool     conversion_finished = true;
+	volatile uint16_t result[8];  /* latest decimated values */
+	volatile uint8_t  seq = 0;    /* incremented on every result update */
+	volatile uint8_t  channel = poti_0; /* first in schedule */
+	uint8_t           position = 0;   /* in the schedule */
+	uint16_t          accu[8];
+	uint8_t           count[8];
 
 	inline void set_channel(uint8_t ch){ ADMUX = adc::vref | ch; }
 	inline void enable(void)           { ADCSRA |= 1<<ADEN; }
 	inline void interrupt_enable(void) { ADCSRA |= 1<<ADIE; }
 	inline void start_conversion(void) { ADCSRA |= 1<<ADSC; }
 
-	inline void restart(void) {
-		while(!conversion_finished);
-		start_conversion();
-		conversion_finished = false;
-	}
-
 	inline void set_clock(void) {
  		/*
-			board clock is 16MHz, set prescaler to 128
-			16.000kHz / 128 = 125kHz ADC clock
-			(allowed range is 50..200kHz)
+			board clock is 16MHz, set prescaler to 64
+			16.000kHz / 64 = 250kHz ADC clock
+			(50..200kHz for full resolution, see above)
 		*/
-		ADCSRA |= (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0);
+		static_assert(64 == prescaler, "ADPS bits do not match the prescaler.");
+		ADCSRA = (ADCSRA & ~((1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0)))
+		       | (1<<ADPS2) | (1<<ADPS1);
 	}
 
-	inline void init() {
+	/* time between two results of a channel, conversions back to back */
+	constexpr uint32_t update_period_us(uint8_t ch) {
+		return (uint32_t) conversion_us * schedule::length * oversampling / schedule::occurrences(ch);
+	}
+
+	struct snapshot { uint16_t value[8]; };
 
-		//TODO init this at compile time
-		next[poti_0] = poti_1;
-		next[poti_1] = poti_2;
-		next[poti_2] = poti_3;
-		next[poti_3] = brgt_0;
-		next[brgt_0] = brgt_1;
-		next[brgt_1] = poti_0;
+	/* coherent copy of all results, lock-free */
+	inline void get_snapshot(snapshot& s) {
+		uint8_t begin;
+		do {
+			begin = seq;
+			for (uint8_t i = 0; i < 8; ++i)
+				s.value[i] = result[i];
+		} while (begin != seq);
+	}
+
+	inline uint8_t next_channel(void) {
+		if (++position == schedule::length) position = 0;
+		return pgm_read_byte(&schedule::table()[position]);
+	}
 
-		for (uint8_t i = 0; i < 8; ++i)
+	inline void init() {
+		channel  = pgm_read_byte(&schedule::table()[0]);
+		position = 0;
+
+		for (uint8_t i = 0; i < 8; ++i) {
 			result[i] = 0;
+			accu[i]   = 0;
+			count[i]  = 0;
+		}
 
 		set_channel(channel);
 		set_clock();
 		enable();
 		interrupt_enable();
+		start_conversion(); /* runs on its own from here */
 	}
 }
 
 ISR(ADC_vect)
 {
-	adc::result[adc::channel] = ADC;         // read result (10 bit)
-	adc::channel = adc::next[adc::channel];  // select next channel
+	const uint8_t ch = adc::channel;
+	adc::accu[ch] += ADC;                    // accumulate result (10 bit)
+	if (++adc::count[ch] == adc::oversampling) {
+		adc::result[ch] = adc::accu[ch] >> adc::decimation_shift;
+		++adc::seq;                          // invalidate running reads
+		adc::accu[ch]  = 0;
+		adc::count[ch] = 0;
+	}
+	adc::channel = adc::next_channel();      // select next channel
 	adc::set_channel(adc::channel);          // multiplex adc
-
-	if (adc::channel != adc::first)          // restart conversion
-		adc::start_conversion();
-	else
-		adc::conversion_finished = true;
+	adc::start_conversion();                 // free running
 }
 
 } /* namespace supreme */
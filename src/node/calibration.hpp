@@ -0,0 +1,144 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_CALIBRATION_HPP
+#define JETPACK_CALIBRATION_HPP
+
+#include <avr/eeprom.h>
+#include "jcl_capsense.hpp"
+#include "checksum.hpp"
+
+/*
+	Persistent calibration of the capacitive sensors.
+
+	The learned weights and biases are kept in a ring of records in the
+	EEPROM (wear levelling), each save goes to the next slot with an
+	incremented sequence number. On boot the newest valid record is
+	restored, so the sensors are calibrated from the first cycle.
+
+	record: <version> <seq> <w0> <w1> <b0> <b1> <chk>
+
+	Writing is non-blocking, one byte per step while the EEPROM is
+	ready (~3.3ms per byte). The version byte is invalidated first and
+	written last, so a record interrupted by a brownout is never valid.
+	Hence the version cell of a slot takes two write cycles per save.
+	A save requested while writing is queued and started, with a fresh
+	copy of the state, as soon as the current record is committed.
+*/
+
+namespace jetpack {
+
+class calibration {
+public:
+	static const uint8_t  version   = 1;    /* increment on format changes */
+	static const uint16_t base      = 64;   /* eeprom address of the ring */
+	static const uint8_t  num_slots = 8;
+	static const uint8_t  invalid   = 0xFF; /* erased cell */
+
+	struct record {
+		uint8_t  version;
+		uint8_t  seq;
+		uint32_t w[2];
+		int32_t  b[2];
+		uint8_t  chk;
+	};
+
+	static const uint8_t record_size = sizeof(record);
+
+private:
+	record  rec = record();
+	uint8_t slot = num_slots - 1; /* last written or restored slot */
+	uint8_t pos  = 0;             /* write progress, 0..record_size */
+	bool    writing = false;
+	bool    queued  = false;          /* save requested while writing */
+
+	static uint8_t* address(uint8_t s, uint8_t offset = 0) {
+		return (uint8_t*) (uintptr_t) (base + s * record_size + offset);
+	}
+
+	static uint8_t compute_checksum(const record& r) {
+		checksum chk;
+		const uint8_t* p = (const uint8_t*) &r;
+		for (uint8_t i = 0; i < record_size - 1; ++i)
+			chk.add(p[i]);
+		return chk.trailer();
+	}
+
+	static bool read_slot(uint8_t s, record& r) {
+		eeprom_read_block(&r, address(s), record_size);
+		return (version == r.version) and (compute_checksum(r) == r.chk);
+	}
+
+public:
+
+	/* find the newest record, i.e. the valid slot not followed by its successor */
+	bool load(CapSense& c0, CapSense& c1) {
+		eeprom_busy_wait();
+		record r, next;
+		bool found = false;
+		for (uint8_t s = 0; s < num_slots and not found; ++s) {
+			if (not read_slot(s, r)) continue;
+			const uint8_t n = (s + 1) % num_slots;
+			if (read_slot(n, next) and next.seq == (uint8_t) (r.seq + 1)) continue;
+			found = true;
+			slot  = s;
+			rec   = r;
+		}
+		if (found) {
+			c0.restore(rec.w[0], rec.b[0]);
+			c1.restore(rec.w[1], rec.b[1]);
+		}
+		return found;
+	}
+
+	/* take a copy of the current state and start writing it to the next slot,
+	   if the previous save is not finished yet, the request is queued */
+	void save(const CapSense& c0, const CapSense& c1) {
+		if (writing) {
+			queued = true;
+			return;
+		}
+		rec.version = version;
+		rec.seq    += 1;
+		rec.w[0]    = c0.w;
+		rec.w[1]    = c1.w;
+		rec.b[0]    = c0.b;
+		rec.b[1]    = c1.b;
+		rec.chk     = compute_checksum(rec);
+		slot        = (slot + 1) % num_slots;
+		pos         = 0;
+		writing     = true;
+	}
+
+	bool busy(void) const { return writing or queued; }
+
+	/* write at most one byte, never waits for the EEPROM */
+	void step(const CapSense& c0, const CapSense& c1) {
+		if (not writing) {
+			if (queued) {
+				queued = false;
+				save(c0, c1);
+			}
+			return;
+		}
+		if (not eeprom_is_ready()) return;
+
+		const uint8_t* p = (const uint8_t*) &rec;
+		if (0 == pos)                   /* invalidate */
+			eeprom_update_byte(address(slot), invalid);
+		else if (pos < record_size)     /* payload and checksum */
+			eeprom_update_byte(address(slot, pos), p[pos]);
+		else {                          /* commit */
+			eeprom_update_byte(address(slot), rec.version);
+			writing = false;
+		}
+		++pos;
+	}
+};
+
+} /* namespace jetpack */
+
+#endif /* JETPACK_CALIBRATION_HPP */
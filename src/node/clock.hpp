@@ -0,0 +1,60 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_CLOCK_HPP
+#define JETPACK_CLOCK_HPP
+
+#include <Arduino.h>
+#include <avr/io.h>
+
+/*
+	Free-running timebase on timer 1.
+
+	Timer 1 is configured exactly the way PWMServo seizes it (fast PWM,
+	ICR1 is top, prescaler 8), so attaching a servo later does not
+	disturb the count. One tick is 0.5 µs, the counter wraps every
+	20 ms, hence intervals must be shorter than that.
+
+	Reading TCNT1 goes through the shared TEMP register, so outside of
+	ISRs it is read with interrupts blocked for two instructions.
+*/
+
+namespace jetpack {
+namespace clock {
+
+	const uint16_t top          = clockCyclesPerMicrosecond()*(20000L/8); /* as in PWMServo */
+	const uint8_t  ticks_per_us = 2;
+
+	inline void init(void) {
+		uint8_t sreg = SREG;
+		cli();
+		TCCR1A = (1<<WGM11);                         /* fast PWM, ICR1 is top */
+		TCCR1B = (1<<WGM13) | (1<<WGM12) | (1<<CS11); /* prescaler 8 */
+		ICR1   = top;
+		SREG   = sreg;
+	}
+
+	/* use from within ISRs */
+	inline uint16_t now_isr(void) { return TCNT1; }
+
+	inline uint16_t now(void) {
+		uint8_t sreg = SREG;
+		cli();
+		uint16_t t = TCNT1;
+		SREG = sreg;
+		return t;
+	}
+
+	inline uint16_t elapsed(uint16_t from, uint16_t to) {
+		return (to >= from) ? to - from : to + (top + 1) - from;
+	}
+
+	inline uint16_t since(uint16_t from) { return elapsed(from, now()); }
+
+} /* namespace clock */
+} /* namespace jetpack */
+
+#endif /* JETPACK_CLOCK_HPP */
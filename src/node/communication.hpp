@@ -12,6 +12,11 @@
 #include <avr/eeprom.h>
 #include "assert.hpp"
 #include "sendbuffer.hpp"
+#include "checksum.hpp"
+#include "report.hpp"
+#include "trace.hpp"
+#include "histogram.hpp"
+#include "scheduler.hpp"
 #include "sensorimotor_node.hpp"
 
 
@@ -31,6 +36,75 @@ public:
 		data_request,
 		data_response,
 		data_set,
+		data_set_all,
+		data_collect,
+		set_mask,
+		set_mask_response,
+		save_calib,
+		save_calib_response,
+		set_range,
+		set_range_response,
+		set_pixels,
+		set_pixels_response,
+		stats_request,
+		stats_response,
+		histogram_request,
+		histogram_response,
+		diag_request,
+		diag_response,
+	};
+
+	/* Broadcast commands (1011.xxxx) carry no single target id, instead
+	 * the id byte holds the first id of a packed array of per-node slices.
+	 * Nodes do not respond to broadcasts. */
+	static const uint8_t slice_len = 4; /* bytes per node in data_set_all */
+
+	/* data_collect: FF FF B0 <first id> <num slots> <slot len> <lead> <chk>
+	 * Node first_id + k responds with a data_response in slot k. Slot k
+	 * starts at lead + k * (slot_len * byte_time + guard) after the end of
+	 * the request. The time counts from the arrival of the request's sync
+	 * bytes, stamped by the RX ISR, not from when the request is parsed,
+	 * which depends on the task the node is busy with. The lead must cover
+	 * the longest task, a node parsing the request after its slot started
+	 * keeps silent (missed_slots). The host knows which tasks are enabled
+	 * (e.g. no pixels) and passes the lead in units of 10us, 0 selects the
+	 * default, which covers the pixel task at its budget (600us) and the
+	 * other tasks of a loop. The guard absorbs interrupt latencies and the
+	 * clock tolerance (crystal, < 100 ppm). */
+	static const uint8_t  guard_us        = 20;
+	static const uint16_t default_lead_us = 1000;
+	static const uint8_t  lead_unit_us    = 10;
+	static const uint8_t  collect_bytes   = 8; /* request incl. sync and checksum */
+
+	/* start of slot k relative to the second sync byte of the request */
+	static uint32_t slot_delay_us(uint8_t k, uint8_t slot_len, uint8_t lead) {
+		const uint16_t slot_us = slot_len * rs485::byte_time_us + guard_us;
+		const uint16_t lead_us = lead ? lead * lead_unit_us : default_lead_us;
+		return (collect_bytes - 2) * rs485::byte_time_us + lead_us + (uint32_t) k * slot_us;
+	}
+
+	/* A frame is dropped if its bytes stop arriving for this long. Large
+	 * enough for gaps in the host's output, e.g. between USB packets. */
+	static const uint16_t watchdog_us = 5000;
+
+	/* diag_response: FF FF A5 <id> <num counters> <num tasks> <counters>
+	 * <tasks> <chk>, counters are 2 bytes each, then per task of the
+	 * scheduler its budget overruns and longest run in us, 2 bytes each */
+	static const uint8_t max_diag_tasks = 8;
+
+	/* Diagnostics counters, saturating, in the order of the diag_response */
+	enum counter_id_t {
+		  dropped_frames     /* all frames ending in the error state */
+		, checksum_errors
+		, watchdog_resyncs   /* frame not completed in time */
+		, ignored_commands   /* unknown command byte */
+		, other_frames       /* frames for other ids */
+		, processed_commands
+		, uart_overruns
+		, uart_frame_errors
+		, rx_ring_overflows
+		, missed_slots       /* data_collect slot passed or too short */
+		, num_counters
 	};
 
 	enum command_state_t {
@@ -50,8 +124,15 @@ private:
 	CoreType&                    ux;
 
 	uint8_t                      recv_buffer   = 0;
-	uint8_t                      recv_checksum = 0;
-	sendbuffer<32>               send;
+	checksum                     recv_checksum;
+
+	uint8_t                      recv_chunk[16]; /* bytes drained from the rx ring in one go */
+	uint8_t                      recv_chunk_len = 0;
+	uint8_t                      recv_chunk_pos = 0;
+	uint8_t                      recv_chunk_at  = 0; /* ring position of recv_chunk[0] */
+	uint16_t                     t_sync = 0;         /* arrival of the frame's sync bytes, clock ticks */
+	bool                         t_sync_valid = false;
+	sendbuffer<64>               send;
 
 	uint8_t                      motor_id  = 127; // set to default
 	uint8_t                      target_id = 127;
@@ -65,20 +146,35 @@ private:
 	bool                         loop_sync  = false;
 
 	uint8_t                      num_bytes_read = 0;
-	uint16_t                     errors = 0;
+	uint16_t                     counter[num_counters];
+	uint8_t                      uart_seen[3] = {0, 0, 0}; /* last values of the usart's counters */
 
 	int                          exp_num_recv_bytes = 0;
 	uint8_t                      dat[256];
+	uint16_t                     slice_offset = 0; /* own slice in broadcast payload */
+	uint8_t                      slot_index   = 0; /* own slot in collective readout */
+	uint16_t                     new_mask     = 0;
+
+	uint32_t                     t_received = 0; /* micros when bytes were last taken from the ring */
 
-	uint8_t                      watchdog = 0; /* reset com module if no new bytes arrived
-                                                  for several steps while in parsing. */
+	task*                        tasks     = nullptr; /* of the scheduler, for the diag_response */
+	uint8_t                      num_tasks = 0;
 
 public:
 
 	communication_ctrl(CoreType& ux)
 	: ux(ux)
+	, counter()
 	{
 		read_id_from_EEPROM();
+		read_mask_from_EEPROM();
+		read_range_from_EEPROM();
+	}
+
+	/* task table of the scheduler, its statistics go into the diag_response */
+	void attach_tasks(task* table, uint8_t n) {
+		tasks     = table;
+		num_tasks = (n < max_diag_tasks) ? n : max_diag_tasks;
 	}
 
 	bool check_and_reset_loop_sync(void) {
@@ -90,27 +186,98 @@ public:
 
 	void read_id_from_EEPROM(void) {
 		eeprom_busy_wait();
-		uint8_t read_id = eeprom_read_byte((uint8_t*)23);
+		uint8_t read_id = eeprom_read_byte((uint8_t*)(uintptr_t)23);
 		if (read_id) /* MSB is set, check if this id was written before */
 			motor_id = read_id & 0x7F;
+		rs485::set_address(motor_id);
 	}
 
 	void write_id_to_EEPROM(uint8_t new_id) {
 		eeprom_busy_wait();
-		eeprom_write_byte((uint8_t*)23, (new_id | 0x80));
+		eeprom_write_byte((uint8_t*)(uintptr_t)23, (new_id | 0x80));
+	}
+
+	/* report mask is stored with its complement to detect unwritten cells */
+	void read_mask_from_EEPROM(void) {
+		eeprom_busy_wait();
+		const uint16_t mask = eeprom_read_word((uint16_t*)(uintptr_t)24);
+		const uint16_t inv  = eeprom_read_word((uint16_t*)(uintptr_t)26);
+		if (mask == (uint16_t) ~inv)
+			ux.set_report_mask(mask);
+	}
+
+	void write_mask_to_EEPROM(uint16_t mask) {
+		eeprom_busy_wait();
+		eeprom_update_word((uint16_t*)(uintptr_t)24,  mask);
+		eeprom_update_word((uint16_t*)(uintptr_t)26, ~mask);
+	}
+
+	/* rangefinder profile: budget (lsb) and period (msb), with complement */
+	void read_range_from_EEPROM(void) {
+		eeprom_busy_wait();
+		const uint16_t profile = eeprom_read_word((uint16_t*)(uintptr_t)28);
+		const uint16_t inv     = eeprom_read_word((uint16_t*)(uintptr_t)30);
+		if (profile == (uint16_t) ~inv)
+			ux.set_range_profile(profile & 0xff, profile >> 8);
+	}
+
+	void write_range_to_EEPROM(uint8_t budget_ms, uint8_t period_ms) {
+		const uint16_t profile = budget_ms | (uint16_t) period_ms << 8;
+		eeprom_busy_wait();
+		eeprom_update_word((uint16_t*)(uintptr_t)28,  profile);
+		eeprom_update_word((uint16_t*)(uintptr_t)30, ~profile);
 	}
 
 	inline
 	bool byte_received(void) {
-		bool result = rs485::read(recv_buffer);
-		if (result)
-			recv_checksum += recv_buffer;
-		return result;
+		if (recv_chunk_pos == recv_chunk_len) {
+			recv_chunk_at  = rs485::read_position();
+			recv_chunk_len = rs485::read(recv_chunk, sizeof(recv_chunk));
+			recv_chunk_pos = 0;
+			if (0 == recv_chunk_len) return false;
+			t_received = micros();
+		}
+		recv_buffer = recv_chunk[recv_chunk_pos++];
+		recv_checksum.add(recv_buffer);
+		return true;
 	}
 
 	command_state_t get_state()    const { return cmd_state; }
 	uint8_t         get_motor_id() const { return motor_id; }
-	uint16_t        get_errors()   const { return errors; }
+	uint16_t        get_errors()   const { return counter[dropped_frames]; }
+	uint16_t        get_counter(uint8_t i) const { return (i < num_counters) ? counter[i] : 0; }
+
+	void count(uint8_t i, uint8_t n = 1) {
+		counter[i] = (counter[i] < 0xffff - n) ? counter[i] + n : 0xffff;
+	}
+
+	/* fold the usart's free running 8 bit counters into ours */
+	void update_uart_counters(void) {
+		const uint8_t now[3] = { usart::rx_overruns, usart::rx_frame_errors, usart::rx_ring_overflows };
+		for (uint8_t i = 0; i < 3; ++i) {
+			count(uart_overruns + i, now[i] - uart_seen[i]);
+			uart_seen[i] = now[i];
+		}
+	}
+
+	void reset_counters(void) {
+		for (uint8_t i = 0; i < num_counters; ++i)
+			counter[i] = 0;
+		for (uint8_t i = 0; i < num_tasks; ++i) {
+			tasks[i].overruns = 0;
+			tasks[i].max_us   = 0;
+		}
+	}
+
+	/* how to continue with a frame addressed to someone else */
+	command_state_t skip_others_data() {
+		count(other_frames);
+#if JETPACK_RS485_MPCM
+		return finished; /* payload is dropped by the usart hardware */
+#else
+		return eating;   /* 8N1, parse and drop the payload */
+#endif
+	}
 
 	command_state_t waiting_for_id()
 	{
@@ -120,17 +287,44 @@ public:
 			/* single byte commands */
 			case data_request:
 			case ping:
-				return (motor_id == recv_buffer) ? verifying : eating;
+			case save_calib:
+			case stats_request:
+				return (motor_id == recv_buffer) ? verifying : skip_others_data();
 
 			/* multi-byte commands */
 			case data_set:
 			case set_id:
-				return (motor_id == recv_buffer) ? reading : eating;
+			case set_mask:
+			case set_range:
+			case set_pixels:
+			case histogram_request:
+			case diag_request:
+				return (motor_id == recv_buffer) ? reading : skip_others_data();
+
+			/* broadcasts, id is the first id of the slice array */
+			case data_set_all:
+				if (motor_id < recv_buffer) {
+					count(other_frames);
+					return eating; /* broadcast, payload is received in both modes */
+				}
+				slice_offset = (motor_id - recv_buffer) * slice_len;
+				return reading;
+
+			case data_collect:
+				slot_index = (motor_id >= recv_buffer) ? motor_id - recv_buffer : 0xFF;
+				return reading;
 
 			/* responses */
-			case ping_response:   return eating;
-			case set_id_response: return eating;
-			case data_response:   return eating;
+			case ping_response:   return skip_others_data();
+			case set_id_response: return skip_others_data();
+			case set_mask_response: return skip_others_data();
+			case save_calib_response: return skip_others_data();
+			case set_range_response: return skip_others_data();
+			case set_pixels_response: return skip_others_data();
+			case stats_response:  return skip_others_data();
+			case histogram_response: return skip_others_data();
+			case diag_response:   return skip_others_data();
+			case data_response:   return skip_others_data();
 
 			default: /* unknown command */ break;
 		}
@@ -140,28 +334,9 @@ public:
 
 	void prepare_data_response(void)
 	{
-		const uint8_t exp_num_data_bytes = 11;
-
-		send.add_byte(0xC1); /* 0101.0001 */
-		send.add_byte(motor_id);
-		send.add_byte(exp_num_data_bytes); // N
-
-		send.add_byte(num_bytes_read);
-
-		send.add_byte(ux.get_position(0));
-		send.add_byte(ux.get_position(1));
-		send.add_byte(ux.get_position(2));
-		send.add_byte(ux.get_position(3));
-
-		send.add_byte(ux.get_luminous(0));
-		send.add_byte(ux.get_luminous(1));
-
-		send.add_byte(ux.get_capacity(0));
-		send.add_byte(ux.get_capacity(1));
-
-		send.add_word(ux.get_distance());
-
-		assert(send.size() == exp_num_data_bytes + 5, 0x7F); // 2 sync + cmd + id + N
+		/* payload was already published by the sensors, only patch id and counter */
+		auto& report = ux.get_report();
+		send.attach(report.finalize(motor_id, num_bytes_read), report.size());
 	}
 
 	command_state_t process_command()
@@ -181,6 +356,26 @@ public:
 				loop_sync = true;
 				break;
 
+			case data_collect:
+				if (slot_index < dat[0]) {
+					prepare_data_response();
+					const bool fits = (send.size() + 1 <= dat[1]); /* + checksum */
+					if (not (fits and t_sync_valid and send.flush_at(t_sync, slot_delay_us(slot_index, dat[1], dat[2])))) {
+						send.discard();
+						count(missed_slots);
+					}
+					loop_sync = true;
+				}
+				break;
+
+			case data_set_all: /* no response */
+				if (slice_offset + slice_len <= exp_num_recv_bytes) {
+					ux.set_target_pwm(dat);
+					ux.enable();
+					loop_sync = true;
+				}
+				break;
+
 			case ping:
 				send.add_byte(0xE1); /* 1110.0001 */
 				send.add_byte(motor_id);
@@ -194,6 +389,81 @@ public:
 				send.add_byte(motor_id);
 				break;
 
+			case set_mask:
+				write_mask_to_EEPROM(new_mask);
+				ux.set_report_mask(new_mask);
+				send.add_byte(0x91); /* 1001.0001 */
+				send.add_byte(motor_id);
+				break;
+
+			case set_range: /* budget 0: query only */
+				if (dat[0] and ux.set_range_profile(dat[0], dat[1]))
+					write_range_to_EEPROM(dat[0], dat[1]);
+				send.add_byte(0x39); /* 0011.1001 */
+				send.add_byte(motor_id);
+				send.add_byte(ux.get_range_budget());
+				send.add_byte(ux.get_range_period());
+				break;
+
+			case set_pixels:
+				if (not ux.set_pixels(dat, num_bytes_read)) return error;
+				send.add_byte(0x61); /* 0110.0001 */
+				send.add_byte(motor_id);
+				break;
+
+			case stats_request: /* per stage: min, max, mean in µs, restarts statistics */
+				send.add_byte(0xA1); /* 1010.0001 */
+				send.add_byte(motor_id);
+#if JETPACK_TRACE
+				send.add_byte(trace::num_used);
+				for (uint8_t i = 0; i < trace::num_used; ++i) {
+					const trace::stats& s = trace::stage[i];
+					send.add_word(s.min    / clock::ticks_per_us);
+					send.add_word(s.max    / clock::ticks_per_us);
+					send.add_word(s.mean() / clock::ticks_per_us);
+				}
+				trace::reset();
+#else
+				send.add_byte(0); /* no stages traced */
+#endif
+				break;
+
+			case histogram_request: /* <which>, msb set: reset after reading */
+			{
+				const uint8_t which = dat[0] & 0x7F;
+				if (which >= CoreType::num_histograms) return error;
+				log_histogram& h = ux.get_histogram(which);
+				send.add_byte(0xA3); /* 1010.0011 */
+				send.add_byte(motor_id);
+				send.add_byte(which);
+				send.add_byte(log_histogram::num_bins);
+				for (uint8_t k = 0; k < log_histogram::num_bins; ++k)
+					send.add_word(h.get(k));
+				if (dat[0] & 0x80) h.reset();
+				break;
+			}
+
+			case diag_request: /* <flags>, msb set: reset after reading */
+				update_uart_counters();
+				send.add_byte(0xA5); /* 1010.0101 */
+				send.add_byte(motor_id);
+				send.add_byte(num_counters);
+				send.add_byte(num_tasks);
+				for (uint8_t i = 0; i < num_counters; ++i)
+					send.add_word(counter[i]);
+				for (uint8_t i = 0; i < num_tasks; ++i) {
+					send.add_word(tasks[i].overruns);
+					send.add_word(tasks[i].max_us);
+				}
+				if (dat[0] & 0x80) reset_counters();
+				break;
+
+			case save_calib: /* written in the background, queued if a save is in progress */
+				ux.save_calibration();
+				send.add_byte(0x31); /* 0011.0001 */
+				send.add_byte(motor_id);
+				break;
+
 			default: /* unknown command */
 				assert(false, 2);
 				break;
@@ -219,6 +489,40 @@ public:
 					return (num_bytes_read < exp_num_recv_bytes) ? reading : verifying;
 				}
 
+			case data_set_all: /* pick own slice while streaming */
+				if (-1 == exp_num_recv_bytes) {
+					exp_num_recv_bytes = recv_buffer;
+					return (exp_num_recv_bytes > 0) ? reading : verifying;
+				}
+				else {
+					const uint16_t i = num_bytes_read++ - slice_offset;
+					if (i < slice_len) dat[i] = recv_buffer;
+					return (num_bytes_read < exp_num_recv_bytes) ? reading : verifying;
+				}
+
+			case set_pixels: /* N <mode> <args...> */
+				if (-1 == exp_num_recv_bytes) {
+					exp_num_recv_bytes = recv_buffer;
+					return (exp_num_recv_bytes > 0) ? reading : error;
+				}
+				else {
+					dat[num_bytes_read++] = recv_buffer;
+					return (num_bytes_read < exp_num_recv_bytes) ? reading : verifying;
+				}
+
+			case histogram_request:
+			case diag_request:
+				dat[num_bytes_read++] = recv_buffer;
+				return verifying;
+
+			case set_range: /* budget ms, period ms */
+				dat[num_bytes_read++] = recv_buffer;
+				return (num_bytes_read < 2) ? reading : verifying;
+
+			case data_collect: /* num slots, slot len, lead */
+				dat[num_bytes_read++] = recv_buffer;
+				return (num_bytes_read < 3) ? reading : verifying;
+
 			case set_id:
 				if (recv_buffer < 128) {
 					target_id = recv_buffer;
@@ -226,6 +530,16 @@ public:
 				}
 				else return error;
 
+			case set_mask: /* <fields> [<extensions>] */
+				if (0 == num_bytes_read++) {
+					new_mask = recv_buffer;
+					return (recv_buffer & report_field::extended) ? reading : verifying;
+				}
+				if (recv_buffer & report_ext::reserved) return error;
+				new_mask |= (uint16_t) recv_buffer << 8;
+				if (0 == recv_buffer) new_mask &= ~report_field::extended;
+				return verifying;
+
 			default: /* unknown command */ break;
 		}
 		assert(false, 4);
@@ -241,14 +555,49 @@ public:
 			case ping:
 			case ping_response:
 			case set_id_response:
+			case set_mask_response:
+			case save_calib:
+			case save_calib_response:
+			case set_pixels_response:
+			case stats_request:
 				assert(num_bytes_read == 1, 77);
 				return finished;
 
 			case set_id:
+			case histogram_request:
+			case diag_request:
 				return (num_bytes_read <  2) ? eating : finished;
 
+			case diag_response: /* <num counters> <num tasks>, 2 bytes per counter, 4 per task */
+				if (1 == num_bytes_read)
+					exp_num_recv_bytes = 2 * recv_buffer + 2;
+				if (2 == num_bytes_read)
+					exp_num_recv_bytes += 4 * recv_buffer;
+				return (num_bytes_read < 2 or num_bytes_read < exp_num_recv_bytes+1) ? eating : finished;
+
+			case histogram_response: /* <which> <num bins> 2 bytes each */
+				if (2 == num_bytes_read)
+					exp_num_recv_bytes = 2 * recv_buffer + 2;
+				return (num_bytes_read < 2 or num_bytes_read < exp_num_recv_bytes+1) ? eating : finished;
+
+			case set_range:
+			case set_range_response:
+				return (num_bytes_read <  3) ? eating : finished;
+
+			case stats_response: /* <num stages> 6 bytes each */
+				if (-1 == exp_num_recv_bytes)
+					exp_num_recv_bytes = 6 * recv_buffer + 1;
+				return (num_bytes_read < exp_num_recv_bytes+1) ? eating : finished;
+
+			case set_mask:
+				if (1 == num_bytes_read) /* extensions byte follows? */
+					exp_num_recv_bytes = (recv_buffer & report_field::extended) ? 3 : 2;
+				return (num_bytes_read < exp_num_recv_bytes) ? eating : finished;
+
 			case data_set:
+			case data_set_all:
 			case data_response:
+			case set_pixels:
 				if (-1 == exp_num_recv_bytes)
 					exp_num_recv_bytes = recv_buffer;
 				return (num_bytes_read < exp_num_recv_bytes+1) ? eating : finished;
@@ -261,7 +610,9 @@ public:
 
 	command_state_t verify_checksum()
 	{
-		return (recv_checksum == 0) ? pending : error;
+		if (recv_checksum.valid()) return pending;
+		count(checksum_errors);
+		return error;
 	}
 
 	command_state_t get_sync_bytes()
@@ -273,6 +624,7 @@ public:
 
 		if (sync_state) {
 			sync_state = false;
+			t_sync_valid = rs485::sync_time(recv_chunk_at + recv_chunk_pos - 1, t_sync);
 			return awaiting;
 		}
 
@@ -290,11 +642,33 @@ public:
 		case 0x70: /* 0111.0000 */ cmd_id = set_id;                  break;
 		case 0x71: /* 0111.0001 */ cmd_id = set_id_response;         break;
 
+		case 0x90: /* 1001.0000 */ cmd_id = set_mask;                break;
+		case 0x91: /* 1001.0001 */ cmd_id = set_mask_response;       break;
+
+		case 0x30: /* 0011.0000 */ cmd_id = save_calib;              break;
+		case 0x31: /* 0011.0001 */ cmd_id = save_calib_response;     break;
+
+		case 0x38: /* 0011.1000 */ cmd_id = set_range;               break;
+		case 0x39: /* 0011.1001 */ cmd_id = set_range_response;      break;
+
+		case 0x60: /* 0110.0000 */ cmd_id = set_pixels;              break;
+		case 0x61: /* 0110.0001 */ cmd_id = set_pixels_response;     break;
+
+		case 0xA0: /* 1010.0000 */ cmd_id = stats_request;           break;
+		case 0xA1: /* 1010.0001 */ cmd_id = stats_response;          break;
+		case 0xA2: /* 1010.0010 */ cmd_id = histogram_request;       break;
+		case 0xA3: /* 1010.0011 */ cmd_id = histogram_response;      break;
+		case 0xA4: /* 1010.0100 */ cmd_id = diag_request;            break;
+		case 0xA5: /* 1010.0101 */ cmd_id = diag_response;           break;
+
 		case 0xC0: /* 1100.0000 */ cmd_id = data_request;            break;
 		case 0xC1: /* 1100.0001 */ cmd_id = data_response;           break;
 
 		case 0x55: /* 0101.0101 */ cmd_id = data_set;                break;
 
+		case 0xB0: /* 1011.0000 */ cmd_id = data_collect;            break;
+		case 0xB5: /* 1011.0101 */ cmd_id = data_set_all;            break;
+
 		default: /* unknown command */
 			return ignore_cmd;
 
@@ -303,12 +677,19 @@ public:
 		return get_id;
 	}
 
+	/* No byte available while in a frame: reset the com module when the
+	 * bus was silent for too long. Only the silence counts, not the number
+	 * of polls, so frames of any length can be received. */
+	bool watchdog(void) {
+		if (micros() - t_received <= watchdog_us) return false;
+		cmd_state = error;
+		count(watchdog_resyncs);
+		return true;
+	}
+
 	/* return code true means continue processing, false: wait for next byte */
 	bool receive_command()
 	{
-		if (syncing != cmd_state) watchdog++;
-		if (watchdog > 100) cmd_state = error;
-
 		switch(cmd_state)
 		{
 			case syncing:
@@ -317,31 +698,33 @@ public:
 				break;
 
 			case awaiting:
-				if (not byte_received()) return false;
+				if (not byte_received()) return watchdog();
 				cmd_state = search_for_command();
 				break;
 
 			case get_id:
-				if (not byte_received()) return false;
+				if (not byte_received()) return watchdog();
 				cmd_state = waiting_for_id();
 				break;
 
 			case reading:
-				if (not byte_received()) return false;
+				if (not byte_received()) return watchdog();
 				cmd_state = waiting_for_data();
 				break;
 
 			case eating:
-				if (not byte_received()) return false;
+				if (not byte_received()) return watchdog();
 				cmd_state = eating_others_data();
 				break;
 
 			case verifying:
-				if (not byte_received()) return false;
+				if (not byte_received()) return watchdog();
 				cmd_state = verify_checksum();
 				break;
 
 			case pending:
+				if (send.busy()) return false; /* previous response still on the wire */
+				count(processed_commands);
 				cmd_state = process_command();
 				break;
 
@@ -350,21 +733,21 @@ public:
 				cmd_id = no_command;
 				cmd_state = syncing;
 				num_bytes_read = 0;
-				recv_checksum = 0;
+				recv_checksum.reset();
 				exp_num_recv_bytes = -1;
-				watchdog = 0;
 				assert(sync_state == false, 55);
 				/* anything else todo? */
 				break;
 
 			case error:
-				if (errors < 0xffff) ++errors;
+				count(dropped_frames);
 				led::on();
 				send.discard();
 				cmd_state = finished;
 				break;
 
 			case ignore_cmd:
+				count(ignored_commands);
 				cmd_state = finished;
 				break;
 
@@ -379,6 +762,7 @@ public:
 	inline
 	void step() {
 		while(receive_command());
+		update_uart_counters();
 	}
 };
 
@@ -13,10 +13,15 @@
 #include <PWMServo.h>
 #include "neopixel.hpp"
 #include "jcl_capsense.hpp"
+#include "calibration.hpp"
 #include "rangef.h"
+#include "imu.hpp"
 #include "adc.hpp"
+#include "report.hpp"
 #include "sensorimotor_node.hpp"
 #include "assert.hpp"
+#include "clock.hpp"
+#include "histogram.hpp"
 
 namespace jetpack {
 
@@ -24,12 +29,6 @@ CapSense cap0 = CapSense(CAPSEND,CAPRET0);
 CapSense cap1 = CapSense(CAPSEND,CAPRET1);
 
 
-/*
-  TODOs:
-  * adc in freewheel mode
-
-*/
-
 /* WARNING: Do NOT you the common Servo.h library,
  * the ISR takes ~15µs and trashes the 10µs bytes
  * of the 1Mbaud communication loop.
@@ -40,54 +39,131 @@ class Sensors {
 public:
     uint8_t position[4] = {0,0,0,0};
     uint8_t luminous[2] = {0,0};
+    uint16_t position_raw[4] = {0,0,0,0}; /* full 12 bit, oversampled */
+    uint16_t luminous_raw[2] = {0,0};
     uint8_t capacity[2] = {0,0};
     uint16_t distance = 0;
+    uint8_t  distance_seq = 0; /* changes with every new distance sample */
 
+    data_report report;
+    uint16_t    report_mask = report_field::all; /* lsb: fields, msb: extensions */
 
     Rangefinder rangef;
-    //TODO: MPU
+    IMU         imu;
+
+    calibration calib;
+    uint32_t    last_save = 0;
+    static const uint32_t save_interval_ms = 15UL*60*1000; /* 8 slots, 100k cycles, 2 writes of the version cell per save: ~11 years */
 
     Sensors() { }
 
     void init() {
         supreme::adc::init();
-        supreme::adc::restart();
+        twi::init();
         rangef.init();
+        imu.init();
+        calib.load(cap0, cap1);
     }
 
     //uint8_t readpin(uint8_t pin) { return analogRead(pin) >> 2; } // 10 -> 8 bit
 
-    void step(void)
+    void step_adc(void)
     {
-        position[0] = supreme::adc::result[supreme::adc::poti_0] >> 2;
-        position[1] = supreme::adc::result[supreme::adc::poti_1] >> 2;
-        position[2] = supreme::adc::result[supreme::adc::poti_2] >> 2;
-        position[3] = supreme::adc::result[supreme::adc::poti_3] >> 2;
+        supreme::adc::snapshot adc;
+        supreme::adc::get_snapshot(adc);
 
-        luminous[0] = supreme::adc::result[supreme::adc::brgt_0] >> 2;
-        luminous[1] = supreme::adc::result[supreme::adc::brgt_1] >> 2;
+        position_raw[0] = adc.value[supreme::adc::poti_0];
+        position_raw[1] = adc.value[supreme::adc::poti_1];
+        position_raw[2] = adc.value[supreme::adc::poti_2];
+        position_raw[3] = adc.value[supreme::adc::poti_3];
 
-        supreme::adc::restart();
+        luminous_raw[0] = adc.value[supreme::adc::brgt_0];
+        luminous_raw[1] = adc.value[supreme::adc::brgt_1];
 
-        digitalWrite(3, LOW);
-        delayMicroseconds(2);
-        digitalWrite(3, HIGH);
+        for (uint8_t i = 0; i < 4; ++i) position[i] = position_raw[i] >> 4; // 12 -> 8 bit
+        for (uint8_t i = 0; i < 2; ++i) luminous[i] = luminous_raw[i] >> 4;
+    }
 
-        capacity[0] = 127*cap0.step() + 128;
+    void step_capsense(void)
+    {
+        capsense::step(); /* collect and restart background measurement */
 
-        digitalWrite(3, LOW);
-        delayMicroseconds(2);
-        digitalWrite(3, HIGH);
+        cap0.step();
+        capacity[0] = cap0.get_byte();
 
-        capacity[1] = 127*cap1.step() + 128;
+        cap1.step();
+        capacity[1] = cap1.get_byte();
 
-        digitalWrite(3, LOW);
-        delayMicroseconds(2);
-        digitalWrite(3, HIGH);
+        /* persist learned calibration periodically */
+        if (millis() - last_save > save_interval_ms) {
+            last_save = millis();
+            calib.save(cap0, cap1);
+        }
+        calib.step(cap0, cap1);
+    }
 
-        rangef.step();
+    void step_i2c(void)
+    {
+        /* i2c devices take turns on the bus, as long as one has work and
+           the budget lasts, a finished transaction is followed by the next */
+        const uint16_t t_start = clock::now();
+        do {
+            twi::step(t_start);
+            rangef.step();
+            imu.step();
+        } while ((twi::busy() or twi::no_owner != twi::owner)
+             and clock::since(t_start) < twi::step_budget_ticks);
         distance = rangef.dx;
-	}
+        distance_seq = rangef.seq;
+    }
+
+    /* prepare the data response payload now, not when requested */
+    void publish(void) {
+        uint8_t* p = report.back();
+        if (nullptr == p) return; /* still being sent, keep previous */
+        const uint8_t mask = report_mask & 0xff;
+        const uint8_t ext  = report_mask >> 8;
+        uint8_t n = 0;
+        p[n++] = mask;
+        if (mask & report_field::extended)
+            p[n++] = ext;
+
+        if (ext & report_ext::hires) {
+            uint16_t v[6];
+            uint8_t  k = 0;
+            for (uint8_t i = 0; i < 4; ++i)
+                if (mask & (report_field::poti_0 << i)) v[k++] = position_raw[i] >> 2; // 12 -> 10 bit
+            if (mask & report_field::luminous) {
+                v[k++] = luminous_raw[0] >> 2;
+                v[k++] = luminous_raw[1] >> 2;
+            }
+            n += pack10(&p[n], v, k);
+        } else {
+            for (uint8_t i = 0; i < 4; ++i)
+                if (mask & (report_field::poti_0 << i)) p[n++] = position[i];
+            if (mask & report_field::luminous) {
+                p[n++] = luminous[0];
+                p[n++] = luminous[1];
+            }
+        }
+        if (mask & report_field::capacity) {
+            p[n++] = capacity[0];
+            p[n++] = capacity[1];
+        }
+        if (mask & report_field::distance) {
+            p[n++] = (distance >> 8) & 0xff;
+            p[n++] =  distance       & 0xff;
+        }
+        if (ext & report_ext::range_seq)
+            p[n++] = distance_seq;
+        if (ext & report_ext::imu) {
+            for (uint8_t i = 0; i < 6; ++i) {
+                p[n++] = (imu.value[i] >> 8) & 0xff;
+                p[n++] =  imu.value[i]       & 0xff;
+            }
+        }
+        report.publish(n);
+    }
 };
 
 
@@ -138,27 +214,208 @@ public:
 };
 
 
-//TODO: this needs to be improved
+/* Framebuffer for the pixel string. Setting pixels only marks them
+ * dirty, step() transmits the string up to the last dirty pixel, but
+ * not before the latch time of the last transmission has passed.
+ * Unchanged colors cost nothing.
+ *
+ * The string is sent pixel by pixel (~30us) and only while no received
+ * bytes are waiting, communication is never held up for more than one
+ * pixel. Interrupts are only blocked per bit (< 2us, i.e. shorter than
+ * one byte on the bus, see sendByte). If bytes arrive in the middle of
+ * a frame, the frame is dropped: the pause would latch the string at an
+ * undefined pixel, so it is started over from the first pixel after the
+ * latch time. On a busy bus this could go on forever, hence after
+ * max_drops dropped frames in a row the next one is sent in one go. The
+ * RX ring holds ~1.3ms of traffic, more than a full string takes. */
 template <unsigned DATA_PIN>
 class NodePix {
+public:
+    static const uint16_t latch_us  = (RES / 1000UL) + 1;
+    static const uint8_t  max_drops = 2;
+
+    static_assert(PIXELS * 30UL < 1000, "Pixel string too long to be sent in one go.");
+
+private:
+    uint8_t  frame[PIXELS][3];
+    uint8_t  num_dirty = 0; /* pixels to be sent, i.e. last dirty + 1 */
+    uint32_t t_latch   = 0; /* end of last transmission */
+    uint8_t  drops     = 0; /* frames dropped in a row */
+
+public:
+    /* what is shown, set_pixels: <mode> <args> */
+    enum mode_t {
+          target   /* grey from target value, default           */
+        , pixels   /* <first> <r g b>..., uploaded per pixel   */
+        , gradient /* <r g b> <r g b>, first to last pixel     */
+        , bar      /* <source> <r g b>, bar graph of a sensor  */
+        , pulse    /* <r g b> <period 10ms>                    */
+        , rainbow  /* <speed>                                  */
+    };
+
+    static const uint8_t render_ms = 20; /* animations at 50 Hz */
+
+private:
+    uint8_t  mode     = target;
+    uint8_t  color[2][3];
+    uint8_t  param    = 0;    /* bar: source, pulse: period, rainbow: speed */
+    uint16_t hue      = 0;    /* rainbow: hue of the first pixel */
+    uint32_t t_render = 0;
+
+    void set_scaled(uint8_t i, const uint8_t* c, uint8_t s) {
+        set_pixel(i, (c[0] * s) >> 8, (c[1] * s) >> 8, (c[2] * s) >> 8);
+    }
+
+    void render_gradient(void) {
+        for (uint8_t i = 0; i < PIXELS; ++i) {
+            uint8_t c[3];
+            for (uint8_t k = 0; k < 3; ++k)
+                c[k] = color[0][k] + ((int16_t) (color[1][k] - color[0][k]) * i) / (PIXELS - 1);
+            set_pixel(i, c[0], c[1], c[2]);
+        }
+    }
+
+    /* like colorWipe, the last pixel of the bar is dimmed by the remainder */
+    void render_bar(uint8_t value) {
+        const uint16_t n = value * PIXELS;
+        const uint8_t  full = n >> 8;
+        for (uint8_t i = 0; i < PIXELS; ++i)
+            set_scaled(i, color[0], (i < full) ? 255 : (i == full) ? (n & 0xff) : 0);
+    }
+
+    /* triangle from dark to full brightness and back */
+    void render_pulse(void) {
+        const uint16_t t = (millis() / 10) % param;
+        const uint16_t s = (t * 512UL) / param;
+        const uint8_t  b = (s > 255) ? 511 - s : s;
+        for (uint8_t i = 0; i < PIXELS; ++i)
+            set_scaled(i, color[0], b);
+    }
+
+    /* as rainbowCycle, hue runs through r->g->b in 3*256 steps */
+    void render_rainbow(void) {
+        uint16_t h = hue;
+        for (uint8_t i = 0; i < PIXELS; ++i) {
+            if (h >= 3*256) h -= 3*256;
+            const uint8_t step = h & 0xff;
+            switch (h >> 8) {
+                case 0: set_pixel(i, ~step,  step,     0); break;
+                case 1: set_pixel(i,     0, ~step,  step); break;
+                case 2: set_pixel(i,  step,     0, ~step); break;
+            }
+            h += (3*256) / PIXELS;
+        }
+        hue = (hue + param) % (3*256);
+    }
+
 public:
 
     NodePix()
+    : frame()
+    , color()
     {
         ledsetup();
     }
 
-    void init(void) { showColor(64, 32, 64); delay(500); showColor(0, 0, 0); }
+    void init(void) { showColor(64, 32, 64); delay(500); showColor(0, 0, 0); t_latch = micros(); }
+
+    void set_pixel(uint8_t i, uint8_t r, uint8_t g, uint8_t b) {
+        if (i >= PIXELS) return;
+        uint8_t* p = frame[i];
+        if (p[0] == r and p[1] == g and p[2] == b) return;
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+        if (i >= num_dirty) num_dirty = i + 1;
+    }
+
+    void set_color(uint8_t r, uint8_t g, uint8_t b) {
+        for (uint8_t i = 0; i < PIXELS; ++i)
+            set_pixel(i, r, g, b);
+    }
+
+    void set_color(uint8_t val) { set_color(val, val, val); }
 
-    void set_color(uint8_t val) { showColor(val, val, val); }
+    bool is_dirty(void) const { return num_dirty > 0; }
 
     void step() {
         /* remember time of last write and wait until latch time,
-         * otherwise too frequent calls of step will not work.
-         * Alternatively use: show() (which basically waits the needed time. */
+         * otherwise too frequent calls of step will not work. */
+        if (not is_dirty()) return;
+        if (micros() - t_latch < latch_us) return;
+
+        const bool yield = (drops < max_drops);
+        uint8_t pos = 0;
+        while (pos < num_dirty) {
+            if (yield and rs485::available()) break; /* drop frame, start over after latch */
+            sendPixels(frame[pos++], 1);
+        }
+        if (0 == pos) return;
+        if (pos == num_dirty) {
+            num_dirty = 0;
+            drops = 0;
+        } else ++drops;
+        t_latch = micros();
     }
 
-    void disable(void) { set_color(0); }
+    void disable(void) { if (target == mode) set_color(0); }
+
+    uint8_t get_mode(void)   const { return mode; }
+    uint8_t get_source(void) const { return param; }
+
+    /* select mode, returns false if the mode or its arguments are invalid */
+    bool configure(const uint8_t* d, uint8_t len) {
+        if (0 == len) return false;
+        const uint8_t m = d[0];
+        ++d; --len;
+        switch (m) {
+            case target:
+                break;
+            case pixels:
+                if (len < 4 or (len - 1) % 3) return false;
+                for (uint8_t i = 1; i < len; i += 3)
+                    set_pixel(d[0] + i/3, d[i], d[i+1], d[i+2]);
+                break;
+            case gradient:
+                if (len < 6) return false;
+                for (uint8_t k = 0; k < 3; ++k) {
+                    color[0][k] = d[k];
+                    color[1][k] = d[k+3];
+                }
+                break;
+            case bar:
+                if (len < 4) return false;
+                param = d[0];
+                for (uint8_t k = 0; k < 3; ++k) color[0][k] = d[k+1];
+                break;
+            case pulse:
+                if (len < 4 or 0 == d[3]) return false;
+                for (uint8_t k = 0; k < 3; ++k) color[0][k] = d[k];
+                param = d[3];
+                break;
+            case rainbow:
+                if (len < 1) return false;
+                param = d[0];
+                break;
+            default:
+                return false;
+        }
+        mode = m;
+        if (gradient == mode) render_gradient();
+        return true;
+    }
+
+    /* update animations, value is the bar graph's sensor value */
+    void render(uint8_t value) {
+        if (millis() - t_render < render_ms) return;
+        t_render = millis();
+        switch (mode) {
+            case bar:     render_bar(value); break;
+            case pulse:   render_pulse();    break;
+            case rainbow: render_rainbow();  break;
+            default: /* static */            break;
+        }
+    }
 
 };
 
@@ -174,6 +431,13 @@ class sensorimotor_core {
     uint8_t          target[4];
     uint8_t          watchcat = 0;
 
+    /* timing telemetry, µs */
+    log_histogram    period_hist;   /* between motor steps */
+    log_histogram    latency_hist;  /* new target values until applied */
+    uint32_t         t_step   = 0;
+    uint32_t         t_target = 0;
+    bool             target_pending = false;
+
 public:
 
     sensorimotor_core()
@@ -194,7 +458,8 @@ public:
           srv.enable();
           //esc.enable();
 
-          pix.set_color(target[2]);//, target[3]);
+          if (pix.target == pix.get_mode())
+              pix.set_color(target[2]);//, target[3]);
 
         } else { /*disabled*/
           srv.disable();
@@ -203,23 +468,50 @@ public:
         }
     }
 
-    void init(void) { sensors.init(); pix.init(); }
+    void init(void) { clock::init(); sensors.init(); pix.init(); }
 
     void step_mot(void) {
         apply_target_values();
-        pix.step();
+
+        const uint32_t now = micros();
+        if (t_step) period_hist.add(now - t_step);
+        t_step = now;
+        if (target_pending) {
+            latency_hist.add(now - t_target);
+            target_pending = false;
+        }
+
         /* safety switchoff */
         if (watchcat < 100) watchcat++;
         else enabled = false;
     }
 
-    void step_sen(void) {
-        sensors.step();
+    void step_pix(void) {
+        pix.render(sensor_value(pix.get_source()));
+        pix.step();
     }
 
+    /* sensors in parts, for scheduling */
+    void step_adc     (void) { sensors.step_adc(); sensors.publish(); }
+    void step_capsense(void) { sensors.step_capsense(); }
+    void step_i2c     (void) { sensors.step_i2c(); }
+
+    /* 8 bit sensor value for the pixel bar graph:
+     * 0..3 position, 4..5 capacity (touch), 6 distance */
+    uint8_t sensor_value(uint8_t source) const {
+        if (source < 4) return sensors.position[source];
+        if (source < 6) return sensors.capacity[source - 4];
+        if (source == 6) return (sensors.distance > 1020) ? 255 : sensors.distance >> 2;
+        return 0;
+    }
+
+    bool set_pixels(const uint8_t* data, uint8_t len) { return pix.configure(data, len); }
+
     void set_target_pwm(uint8_t pwm[4]) {
         for (uint8_t i = 0; i<4; ++i)
             target[i] = pwm[i];
+        t_target = micros();
+        target_pending = true;
     }
 
     void enable()  { enabled = true; watchcat = 0; }
@@ -230,6 +522,25 @@ public:
     uint8_t  get_luminous(uint8_t i) const { assert(i<2, 43); return sensors.luminous[i]; }
     uint8_t  get_capacity(uint8_t i) const { assert(i<2, 44); return sensors.capacity[i]; }
     uint16_t get_distance(void)      const { return sensors.distance; }
+    uint8_t  get_distance_seq(void)  const { return sensors.distance_seq; }
+
+    bool    set_range_profile(uint8_t budget_ms, uint8_t period_ms) { return sensors.rangef.configure(budget_ms, period_ms); }
+    uint8_t get_range_budget(void) const { return sensors.rangef.get_budget(); }
+    uint8_t get_range_period(void) const { return sensors.rangef.get_period(); }
+
+    uint16_t get_position_raw(uint8_t i) const { assert(i<4, 46); return sensors.position_raw[i]; }
+    uint16_t get_luminous_raw(uint8_t i) const { assert(i<2, 47); return sensors.luminous_raw[i]; }
+
+    data_report& get_report(void) { return sensors.report; }
+
+    void     set_report_mask(uint16_t mask) { sensors.report_mask = mask; }
+    uint16_t get_report_mask(void) const    { return sensors.report_mask; }
+
+    void save_calibration(void) { sensors.calib.save(cap0, cap1); }
+
+    enum histogram_id { loop_period, target_latency, num_histograms };
+
+    log_histogram& get_histogram(uint8_t i) { return (loop_period == i) ? period_hist : latency_hist; }
 
 };
 
@@ -0,0 +1,52 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_HISTOGRAM_HPP
+#define JETPACK_HISTOGRAM_HPP
+
+#include <stdint.h>
+
+namespace jetpack {
+
+/*
+	Histogram with logarithmic bins for time intervals in µs.
+
+	Bin 0 counts values below 2, bin k values in [2^k, 2^(k+1)), the last
+	bin everything above. 16 bins cover 1µs to 32ms with saturating 16 bit
+	counters, i.e. 32 bytes of RAM.
+*/
+class log_histogram {
+public:
+	static const uint8_t num_bins = 16;
+
+private:
+	uint16_t bins[num_bins];
+
+public:
+	log_histogram() : bins() {}
+
+	static uint8_t bin_of(uint32_t value) {
+		uint8_t k = 0;
+		while ((value >>= 1) and k < num_bins - 1) ++k;
+		return k;
+	}
+
+	void add(uint32_t value) {
+		uint16_t& b = bins[bin_of(value)];
+		if (b < 0xffff) ++b;
+	}
+
+	void reset(void) {
+		for (uint8_t k = 0; k < num_bins; ++k)
+			bins[k] = 0;
+	}
+
+	uint16_t get(uint8_t k) const { return (k < num_bins) ? bins[k] : 0; }
+};
+
+} /* namespace jetpack */
+
+#endif /* JETPACK_HISTOGRAM_HPP */
@@ -0,0 +1,144 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_IMU_HPP
+#define JETPACK_IMU_HPP
+
+#include "twi.hpp"
+
+/*
+	MPU-6050/9250 inertial measurement unit, read through its FIFO.
+
+	The IMU samples accelerometer and gyroscope at 100 Hz into its
+	internal FIFO (12 bytes per sample: accel x y z, gyro x y z, msb
+	first). Every 10ms the loop reads the FIFO count and then drains all
+	accumulated samples (up to max_burst) in one burst read, the samples
+	are averaged. All transfers go through the shared asynchronous twi
+	bus, a job of count + burst read is followed by the other devices.
+
+	If no IMU answers on setup, the driver stays disabled.
+*/
+
+namespace jetpack {
+
+class IMU {
+public:
+	static const uint8_t  address          = 0x68;
+	static const uint8_t  sample_size      = 12;
+	static const uint8_t  max_burst        = 4;     /* samples per read */
+	static const uint8_t  me               = twi::client::imu;
+	static const uint16_t poll_interval_us = 10000; /* one sample */
+
+	/* registers */
+	enum reg_t {
+		  SMPLRT_DIV   = 0x19
+		, CONFIG       = 0x1A
+		, GYRO_CONFIG  = 0x1B
+		, ACCEL_CONFIG = 0x1C
+		, FIFO_EN      = 0x23
+		, USER_CTRL    = 0x6A
+		, PWR_MGMT_1   = 0x6B
+		, FIFO_COUNT_H = 0x72
+		, FIFO_R_W     = 0x74
+		, WHO_AM_I     = 0x75
+	};
+
+private:
+	enum phase_t { idle, count, burst, reset };
+
+	phase_t  phase   = idle;
+	bool     present = false;
+	uint32_t t_poll  = 0;
+	uint8_t  buf[max_burst * sample_size];
+
+	bool write_sync(uint8_t reg, uint8_t value) {
+		buf[0] = value;
+		twi::write(address, reg, buf, 1);
+		return twi::done == twi::wait();
+	}
+
+	void average(uint8_t num) {
+		for (uint8_t k = 0; k < 6; ++k) {
+			int32_t s = 0;
+			for (uint8_t i = 0; i < num; ++i) {
+				const uint8_t* p = &buf[i * sample_size + 2*k];
+				s += (int16_t) ((p[0] << 8) | p[1]);
+			}
+			value[k] = s / num;
+		}
+		++seq;
+	}
+
+public:
+	int16_t value[6] = {0,0,0,0,0,0}; /* accel x y z (+-4g), gyro x y z (+-500 deg/s) */
+	uint8_t seq      = 0;             /* incremented with every new value */
+
+	/* blocking, call on setup only */
+	void init(void) {
+		twi::read(address, WHO_AM_I, buf, 1);
+		present = (twi::done == twi::wait()) and (0x68 == buf[0] or 0x71 == buf[0]);
+		if (not present) return;
+
+		present = write_sync(PWR_MGMT_1,   0x01)  /* wake up, gyro x pll clock */
+		      and write_sync(SMPLRT_DIV,   9)     /* 1kHz / (1+9) = 100 Hz */
+		      and write_sync(CONFIG,       0x03)  /* low-pass 44 Hz */
+		      and write_sync(GYRO_CONFIG,  0x08)  /* +-500 deg/s */
+		      and write_sync(ACCEL_CONFIG, 0x08)  /* +-4g */
+		      and write_sync(USER_CTRL,    0x44)  /* enable and reset fifo */
+		      and write_sync(FIFO_EN,      0x78); /* accel and gyro into fifo */
+	}
+
+	bool is_present(void) const { return present; }
+
+	void step(void) {
+		if (not present) return;
+		if (idle == phase and micros() - t_poll < poll_interval_us) return;
+		if (not twi::claim(me)) return;
+		if (twi::busy()) return;
+		const bool ok = (twi::done == twi::result());
+
+		switch(phase)
+		{
+			case idle:
+				twi::read(address, FIFO_COUNT_H, buf, 2);
+				t_poll = micros();
+				phase = count;
+				break;
+
+			case count:
+			{
+				const uint16_t n = (buf[0] << 8) | buf[1];
+				if (not ok or n < sample_size) {
+					phase = idle;
+					twi::release(me);
+				}
+				else if (n % sample_size or n >= 1024) { /* misaligned or overflow */
+					buf[0] = 0x44;
+					twi::write(address, USER_CTRL, buf, 1);
+					phase = reset;
+				}
+				else {
+					const uint8_t num = (n / sample_size < max_burst) ? n / sample_size : max_burst;
+					twi::read(address, FIFO_R_W, buf, num * sample_size);
+					phase = burst;
+				}
+				break;
+			}
+
+			case burst:
+				if (ok) average(twi::pos / sample_size);
+				/* no break */
+			case reset:
+				phase = idle;
+				twi::release(me);
+				break;
+		}
+	}
+};
+
+} /* namespace jetpack */
+
+#endif /* JETPACK_IMU_HPP */
@@ -1,4 +1,8 @@
-#include <CapacitiveSensor.h>
+#ifndef JCL_CAPSENSE_HPP
+#define JCL_CAPSENSE_HPP
+
+#include "clock.hpp"
+#include "assert.hpp"
 
 /*-----------------------+
  | CapSense              |
@@ -7,55 +11,259 @@
  | v.0.1 Dec. 19th 2019  |
  +-----------------------*/
 
-/*TODO add writing and reading values to/from EEPROM*/
-
 namespace jetpack {
 
+/*
+	Non-blocking capacitive sensing.
+
+	Same measurement as CapacitiveSensor::capacitiveSensorRaw, the time
+	to charge and discharge the receive pin through the send resistor,
+	but instead of spinning in a counting loop (~0.3ms, up to 1ms per
+	reading) the pin edges are caught by the pin change interrupt and
+	timestamped with the clock (0.5µs ticks). The main loop only starts
+	a measurement and collects the result later, the channels share the
+	send pin and are measured alternately in the background.
+
+	The receive pins must be on port B (PCINT0..7), i.e. pins 8..13.
+*/
+namespace capsense {
+
+	const uint8_t  num_channels  = 2;
+	const uint16_t timeout_ticks = 1000 * clock::ticks_per_us; /* 1ms, as before */
+
+	enum state_t { idle, charging, discharging };
+
+	/* registers changed by isr */
+	volatile uint8_t  state    = idle;
+	volatile bool     ready    = false;
+	volatile uint16_t result   = 0;     /* charge + discharge time in ticks */
+	uint16_t          t_edge   = 0;
+	uint16_t          t_charge = 0;
+
+	/* pins */
+	volatile uint8_t* send_port = nullptr;
+	uint8_t           send_mask = 0;
+	uint8_t           recv_mask[num_channels] = {0, 0};
+	uint8_t           num_registered = 0;
+
+	/* main loop */
+	uint8_t           active  = 0;
+	bool              running = false;
+	uint16_t          t_begin = 0;
+	uint16_t          value[num_channels] = {0, 0};
+	bool              fresh[num_channels] = {false, false};
+
+	inline uint8_t add_channel(uint8_t sendpin, uint8_t recvpin) {
+		assert(num_registered < num_channels, 48);
+		assert(digitalPinToPort(recvpin) == digitalPinToPort(8), 49); /* port B */
+		send_port = portOutputRegister(digitalPinToPort(sendpin));
+		send_mask = digitalPinToBitMask(sendpin);
+		recv_mask[num_registered] = digitalPinToBitMask(recvpin);
+		pinMode(sendpin, OUTPUT);
+		digitalWrite(sendpin, LOW);
+		pinMode(recvpin, OUTPUT);  /* hold low, discharged */
+		digitalWrite(recvpin, LOW);
+		return num_registered++;
+	}
+
+	inline void start(uint8_t ch) {
+		const uint8_t m = recv_mask[ch];
+		active  = ch;
+		t_begin = clock::now();
+
+		uint8_t sreg = SREG;
+		cli();
+		DDRB  &= ~m;              /* receive pin to input, no pullup */
+		PORTB &= ~m;
+		PCIFR  = (1<<PCIF0);
+		PCMSK0 = m;
+		PCICR |= (1<<PCIE0);
+		*send_port |= send_mask;  /* start charging */
+		t_edge = TCNT1;
+		state  = charging;
+		ready  = false;           /* a late result of the previous channel */
+		result = 0;
+		SREG   = sreg;
+	}
+
+	inline void abort(void) {
+		const uint8_t m = recv_mask[active];
+		uint8_t sreg = SREG;
+		cli();
+		PCMSK0 = 0;
+		*send_port &= ~send_mask;
+		DDRB  |= m;               /* hold low */
+		state  = idle;
+		ready  = false;           /* may have come in after the timeout */
+		result = 0;
+		SREG   = sreg;
+	}
+
+	/* collect a finished measurement and start the next, never blocks */
+	inline void step(void) {
+		if (0 == num_registered) return;
+		const uint8_t next = (active + 1) % num_registered;
+
+		if (not running) {
+			running = true;
+			start(active);
+		}
+		else if (ready) {
+			ready = false;
+			value[active] = result;
+			fresh[active] = true;
+			start(next);
+		}
+		else if (clock::since(t_begin) > timeout_ticks) {
+			abort(); /* keep last value */
+			start(next);
+		}
+	}
+
+} /* namespace capsense */
+
+
+/* tanh(i/16) in Q15 for i = 0..64, linear interpolation in between,
+   max. error ~5e-4, saturates at 4 */
+const uint16_t tanh_table[65] PROGMEM = {
+      0,  2045,  4075,  6073,  8025,  9919, 11742, 13486,
+  15142, 16706, 18173, 19541, 20812, 21986, 23065, 24053,
+  24955, 25775, 26518, 27190, 27796, 28340, 28829, 29267,
+  29659, 30009, 30321, 30599, 30846, 31066, 31261, 31435,
+  31588, 31725, 31845, 31952, 32047, 32131, 32205, 32270,
+  32328, 32380, 32425, 32465, 32500, 32531, 32559, 32583,
+  32605, 32624, 32641, 32656, 32669, 32680, 32690, 32699,
+  32707, 32714, 32720, 32726, 32731, 32735, 32739, 32742,
+  32745 };
+
+/* u in Q16, returns tanh(u) in Q15 */
+inline int16_t tanh_q15(int32_t u) {
+  const uint32_t a = (u < 0) ? -u : u;
+  int16_t y;
+  if (a >= (4L << 16))
+    y = pgm_read_word(&tanh_table[64]);
+  else {
+    const uint8_t  i = a >> 12;     /* steps of 1/16 */
+    const uint16_t f = a & 0xFFF;
+    const uint16_t t0 = pgm_read_word(&tanh_table[i]);
+    const uint16_t t1 = pgm_read_word(&tanh_table[i+1]);
+    y = t0 + (((uint32_t) (t1 - t0) * f) >> 12);
+  }
+  return (u < 0) ? -y : y;
+}
+
+/*
+  Single tanh neuron with adaptive weight and bias, in fixed point
+  (the float version took several 100us per step on the AVR).
+
+  x: low-passed raw value,  Q.8  (uint32)
+  w: weight,                Q0.32 (uint32), w < 1
+  b: bias,                  Q.16 (int32)
+  y: output,                Q15 (int16)
+
+  Constants, float version in brackets:
+  lp    = 26/256   (0.1)
+  eta   = 328/2^16 (0.005)
+  eta_w = 2^-21    (5e-7)
+*/
 class CapSense {
-  CapacitiveSensor cs;
+  uint8_t ch;
+  bool    initialized = false;
+  bool    calibrated  = false; /* w and b restored, keep them */
 
 public:
 
-  float x=.0f,y,b=.0f,w;
-  const uint8_t NREAD = 1; /* each reading approx. takes 0.3 ms */
-  const unsigned timeout_ms = 1; /* 2000 is default */
-  const float eta = 0.005f;
-  const float eta_w = .0000005;
-  const float lp = 0.1f;
+  static const uint8_t  lp      = 26;    /* Q.8  */
+  static const int16_t  eta     = 328;   /* Q.16 */
+  static const uint8_t  eta_w   = 21;    /* shift */
+  static const int16_t  y_upper = 19661; /* 0.6 in Q15 */
+  static const int16_t  y_lower = 13107; /* 0.4 in Q15 */
 
+  uint32_t x = 0;
+  uint32_t w = 42949673UL;  /* 0.01 */
+  int32_t  b = 0;
+  int16_t  y = 0;
 
   CapSense(uint8_t sendpin, uint8_t recvpin)
-  : cs(sendpin, recvpin)
-  , y(), w(0.01f), b()
+  : ch(capsense::add_channel(sendpin, recvpin))
   {
-    cs.set_CS_AutocaL_Millis(0xFFFFFFFF);
-    cs.set_CS_Timeout_Millis(timeout_ms);
-    x = _read();
-    b = -w*x;
   }
 
-  float step(void) {
-    x = lp*_read() + (1-lp)*x;
-    y = tanh(w*x + b); /* single tanh neuron */
+  /* w*x in Q.16, using a 16x16 bit multiplication */
+  int32_t wx(void) const { return (int32_t) ((uint32_t) (uint16_t) (w >> 16) * (uint16_t) (x >> 8)); }
+
+  /* update with the latest measurement, if there is a new one */
+  int16_t step(void) {
+    if (!capsense::fresh[ch]) return y;
+    capsense::fresh[ch] = false;
+
+    const uint32_t raw = (uint32_t) capsense::value[ch] << 8;
+    if (!initialized) {
+      x = raw;
+      if (!calibrated) b = -wx();
+      initialized = true;
+    }
+
+    x = x + (((int32_t) (raw - x) * lp) >> 8);
+    const int32_t u = wx() + b;
+    y = tanh_q15(u); /* single tanh neuron */
 
     /* low-pass out the bias/DC component */
-    //b += -eta*y;
-    b += (b > -w*x) ? -eta*y: -10*eta*y;
+    const int32_t db = ((int32_t) eta * y) >> 15;
+    b -= (u > 0) ? db : 10*db;
 
     /* decrease weight w when amp is near saturation,
        or increase w when amp is too lower */
-    if (fabs(y) > .6f) w *= 1-eta_w;
-    if (fabs(y) < .4f) w *= 1+eta_w;
+    const int16_t a = (y < 0) ? -y : y;
+    if (a > y_upper) w -= w >> eta_w;
+    if (a < y_lower && w < 0xFFE00000UL) w += w >> eta_w;
 
     return y;
   }
 
-  float get(void) const { return y; }
+  int16_t get(void) const { return y; }
+
+  /* warm start with a previously learned operating point */
+  void restore(uint32_t w_, int32_t b_) {
+    if (0 == w_) return;
+    w = w_;
+    b = b_;
+    calibrated = true;
+  }
 
-private:
-  float _read(void) { return cs.capacitiveSensorRaw(NREAD)/NREAD; }
+  /* output scaled to 1..255, 128 is zero */
+  uint8_t get_byte(void) const { return 128 + ((127L * y) >> 15); }
 
 };
 
 
 } /* namespace jcl */
+
+ISR(PCINT0_vect)
+{
+	using namespace jetpack::capsense;
+	const uint16_t now   = jetpack::clock::now_isr();
+	const uint8_t  m     = recv_mask[active];
+	const bool     level = PINB & m;
+
+	if (charging == state and level) {
+		t_charge = jetpack::clock::elapsed(t_edge, now);
+		/* charge up fully for a moment, then discharge through send pin */
+		PORTB |= m;
+		DDRB  |= m;
+		DDRB  &= ~m;
+		PORTB &= ~m;
+		*send_port &= ~send_mask;
+		t_edge = jetpack::clock::now_isr();
+		state  = discharging;
+	}
+	else if (discharging == state and not level) {
+		result = t_charge + jetpack::clock::elapsed(t_edge, now);
+		PCMSK0 = 0;
+		DDRB  |= m;               /* hold low until next measurement */
+		state  = idle;
+		ready  = true;
+	}
+}
+
+#endif /* JCL_CAPSENSE_HPP */
@@ -59,6 +59,10 @@ inline void sendBit( bool bitVal ) {
 }
 
 
+// Interrupts are blocked for a single bit only: at most T1H + T1L (1.5us)
+// plus ~6 cycles overhead, i.e. < 2us, which is shorter than one byte on the
+// 1 Mbaud bus (10us). Pending interrupts run between the bits, the gap stays
+// far below the reset time.
 inline void sendByte( unsigned char byte ) {
     for( unsigned char bit = 0 ; bit < 8 ; bit++ ) {
       cli();
@@ -83,6 +87,13 @@ inline void sendPixel( unsigned char r, unsigned char g , unsigned char b ) {
 }
 
 
+void sendPixels( const unsigned char* rgb , unsigned int num ) {
+  for( unsigned int p=0; p<num; p++, rgb+=3 ) {
+    sendPixel(rgb[0], rgb[1], rgb[2]);
+  }
+}
+
+
 void show() {
 	_delay_us( (RES / 1000UL) + 1);	// Round up since the delay must be _at_least_ this long (too short might not work, too long not a problem)
 }
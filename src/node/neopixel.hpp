@@ -58,6 +58,7 @@
   ledSetup() - set up the pin that is connected to the string. Call once at the begining of the program.
   sendPixel( r g , b ) - send a single pixel to the string. Call this once for each pixel in a frame.
   show() - show the recently sent pixel on the LEDs . Call once per frame.
+  sendPixels( rgb , num ) - send num pixels from a buffer of r g b triples, without latch.
 
 */
 
@@ -68,6 +69,8 @@ inline void sendPixel( unsigned char r, unsigned char g , unsigned char b );
 
 void show();
 
+void sendPixels( const unsigned char* rgb , unsigned int num );
+
 
 /*
 
@@ -1,12 +1,12 @@
 #include "communication.hpp"
 #include "sensorimotor_node.hpp"
 #include "core.hpp"
+#include "scheduler.hpp"
 
 
 #define IDLE_TIMEOUT_US 20000 /* 50Hz main loop in idle */
 
 /* timing */
-unsigned long timestamp = 0;
 unsigned long cycles = 0;
 
 /* button state */
@@ -20,36 +20,50 @@ core_t core;
 jetpack::communication_ctrl<core_t> com(core);
 
 
-void setup() {
-  Serial.begin(rs485::baudrate);
+/* tasks */
+void task_motors  (void) { core.step_mot(); ++cycles; }
+void task_adc     (void) { core.step_adc(); }
+void task_capsense(void) { core.step_capsense(); }
+void task_i2c     (void) { core.step_i2c(); }
+void task_pixels  (void) { core.step_pix(); }
+
+enum task_id { motors, adc, capsense, i2c, pixels, num_tasks };
+
+jetpack::task tasks[num_tasks] = {
+  /* function      period us        budget us  priority */
+  { task_motors,   IDLE_TIMEOUT_US,    100,       0 },  /* released by host requests, */
+  { task_adc,      IDLE_TIMEOUT_US,    200,       0 },  /* else at 50Hz in idle       */
+  { task_capsense,    1000,            150,       1 },
+  { task_i2c,          500,            100,       1 },
+  { task_pixels,      1000,            600,       2 },  /* up to 16 pixels */
+};
+
+void poll_communication(void);
+
+jetpack::scheduler<num_tasks> sched(tasks, poll_communication);
+
+/* runs between all tasks */
+void poll_communication(void) {
+  com.step();
+  if (com.check_and_reset_loop_sync()) {
+    sched.release(motors);
+    sched.release(adc);
+  }
+}
 
+
+void setup() {
   button::init();
   led   ::init();
   rs485 ::init();
+  jetpack::slottimer::init();
   core   .init();
-  pinMode(3, OUTPUT);
+  com    .attach_tasks(tasks, num_tasks);
+  sched  .init();
 }
 
 void loop() {
-
-  digitalWrite(3, HIGH);
-  core.step_sen();
-
-  digitalWrite(3, LOW);
-  delayMicroseconds(2);
-  digitalWrite(3, HIGH);
-
-  core.step_mot();
-  digitalWrite(3, LOW);
-  ++cycles;
-
-
-  /* loop delay, wait until timer signals next 1ms slot is done */
-  do {
-    com.step();
-    delayMicroseconds(1);
-  } while(!com.check_and_reset_loop_sync() && (micros() - timestamp < IDLE_TIMEOUT_US));
-  timestamp = micros();
+  sched.step();
 }
 
 
@@ -1,29 +1,246 @@
 #include <VL53L0X.h>
+#include "twi.hpp"
 
 /* time-of-flight sensor */
 
+/* Continuous ranging, read without blocking: the interrupt status is
+ * polled through the asynchronous twi engine, the result is only read
+ * when a new sample is ready and the sensor's interrupt is cleared
+ * afterwards. The bus is shared, it is released after each poll.
+ *
+ * A new profile is applied as a job of the i2c task, not in the command
+ * handler: once the pending poll is finished, the register writes of the
+ * library's stopContinuous, setMeasurementTimingBudget and
+ * startContinuous are issued through the twi engine, one per step,
+ * while the rangefinder keeps the bus. What the library reads or
+ * computes for them (stop variable, oscillator calibration, final range
+ * VCSEL period and timeout) is taken once at init, where blocking is
+ * fine. The final range timeout scales with the budget, so only the
+ * difference to the budget applied at init is converted to macro
+ * periods. A failed write aborts the job. */
 class Rangefinder {
     VL53L0X sensor;
 
+    enum phase_t { idle, status, result, clear, writing };
+
+    static const uint8_t no_job = 0xFF;
+
+    phase_t  phase   = idle;
+    uint8_t  job     = no_job; /* next register write of the reconfiguration */
+    uint32_t t_poll  = 0;
+    uint8_t  address = 0;
+    uint8_t  buf[4]  = {0,0,0,0};
+    bool     running = false;
+
+    /* timing budget in ms, e.g. 20 high speed, 33 default, 200 high accuracy,
+     * and inter-measurement period in ms, 0 is back-to-back */
+    uint8_t budget_ms = 33;
+    uint8_t period_ms = 0;
+
+    /* taken at init */
+    uint8_t  stop_variable     = 0;
+    uint16_t osc_calibrate_val = 0;
+    uint16_t macro_period_ns   = 0;  /* of the final range VCSEL period */
+    uint8_t  init_budget_ms    = 0;
+    uint32_t init_final_mclks  = 0;  /* final range timeout at init_budget_ms */
+
+    void apply(void) {
+        sensor.setMeasurementTimingBudget(budget_ms * 1000UL);
+        /* Start continuous mode, back-to-back takes
+         * readings as fast as possible. */
+        sensor.startContinuous(period_ms);
+    }
+
+    /* register format: LSB * 2^MSB + 1 macro periods */
+    static uint16_t encode_timeout(uint32_t mclks) {
+        if (0 == mclks) return 0;
+        uint32_t ls = mclks - 1;
+        uint8_t  ms = 0;
+        while (ls & 0xFFFFFF00) { ls >>= 1; ++ms; }
+        return ((uint16_t) ms << 8) | (ls & 0xFF);
+    }
+    static uint32_t decode_timeout(uint16_t v) { return ((uint32_t) (v & 0xFF) << (v >> 8)) + 1; }
+
+    uint32_t final_range_mclks(void) const {
+        const int32_t d_ns  = ((int32_t) budget_ms - init_budget_ms) * 1000000L;
+        const int32_t half  = (d_ns < 0) ? -(macro_period_ns / 2) : macro_period_ns / 2;
+        const int32_t mclks = (int32_t) init_final_mclks + (d_ns + half) / (int32_t) macro_period_ns;
+        return (mclks > 0) ? mclks : 1;
+    }
+
+    void put(uint8_t reg, uint8_t value) {
+        buf[0] = value;
+        jetpack::twi::write(address, reg, buf, 1);
+    }
+
+    /* i-th register write of the reconfiguration, false past the end */
+    bool job_write(uint8_t i) {
+        switch(i)
+        {
+            /* stopContinuous */
+            case  0: put(VL53L0X::SYSRANGE_START, 0x01); return true; /* single shot */
+            case  1: put(0xFF, 0x01); return true;
+            case  2: put(0x00, 0x00); return true;
+            case  3: put(0x91, 0x00); return true;
+            case  4: put(0x00, 0x01); return true;
+            case  5: put(0xFF, 0x00); return true;
+
+            /* setMeasurementTimingBudget */
+            case  6: {
+                const uint16_t v = encode_timeout(final_range_mclks());
+                buf[0] = v >> 8;
+                buf[1] = v & 0xff;
+                jetpack::twi::write(address, VL53L0X::FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI, buf, 2);
+                return true;
+            }
+
+            /* startContinuous */
+            case  7: put(0x80, 0x01); return true;
+            case  8: put(0xFF, 0x01); return true;
+            case  9: put(0x00, 0x00); return true;
+            case 10: put(0x91, stop_variable); return true;
+            case 11: put(0x00, 0x01); return true;
+            case 12: put(0xFF, 0x00); return true;
+            case 13: put(0x80, 0x00); return true;
+            case 14:
+                if (0 == period_ms) {
+                    put(VL53L0X::SYSRANGE_START, 0x02); /* back-to-back */
+                    return true;
+                } else {
+                    const uint32_t p = (uint32_t) period_ms * (osc_calibrate_val ? osc_calibrate_val : 1);
+                    buf[0] = p >> 24;
+                    buf[1] = p >> 16;
+                    buf[2] = p >> 8;
+                    buf[3] = p;
+                    jetpack::twi::write(address, VL53L0X::SYSTEM_INTERMEASUREMENT_PERIOD, buf, 4);
+                    return true;
+                }
+            case 15:
+                if (0 == period_ms) return false;
+                put(VL53L0X::SYSRANGE_START, 0x04); /* timed */
+                return true;
+
+            default: return false;
+        }
+    }
+
+    /* next write of the job, the bus is kept until the last one is done */
+    void reconfigure(void) {
+        if (no_job != job and job_write(job)) {
+            ++job;
+            phase = writing;
+            return;
+        }
+        job = no_job;
+        phase = idle;
+        jetpack::twi::release(jetpack::twi::client::rangefinder);
+    }
+
 public:
 
-    uint16_t dx = 0;
+    static const uint8_t  min_budget_ms    = 20;
+    static const uint8_t  max_budget_ms    = 200;
+    static const uint16_t poll_interval_us = 2000; /* latency of a new sample */
+
+    uint16_t dx  = 0;
+    uint8_t  seq = 0; /* incremented with every new sample */
 
     Rangefinder() : sensor() {}
 
     void init(void) {
         sensor.init();
         sensor.setTimeout(1);
-        /* Start continuous back-to-back mode,
-         * take readings as fast as possible. */
-        sensor.startContinuous();
+        address = sensor.getAddress();
+
+        /* what the library's start and budget calls read, as in its init */
+        sensor.writeReg(0x80, 0x01);
+        sensor.writeReg(0xFF, 0x01);
+        sensor.writeReg(0x00, 0x00);
+        stop_variable = sensor.readReg(0x91);
+        sensor.writeReg(0x00, 0x01);
+        sensor.writeReg(0xFF, 0x00);
+        sensor.writeReg(0x80, 0x00);
+        osc_calibrate_val = sensor.readReg16Bit(VL53L0X::OSC_CALIBRATE_VAL);
+        const uint32_t vcsel = sensor.getVcselPulsePeriod(VL53L0X::VcselPeriodFinalRange);
+        macro_period_ns = ((2304UL * vcsel * 1655) + 500) / 1000;
+
+        apply();
+        init_budget_ms   = budget_ms;
+        init_final_mclks = decode_timeout(sensor.readReg16Bit(VL53L0X::FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI));
+        running = true;
+    }
+
+    static bool valid(uint8_t budget, uint8_t period) {
+        return (budget >= min_budget_ms) and (budget <= max_budget_ms)
+           and (0 == period or period >= budget);
+    }
+
+    /* change the profile, applied by the following steps, never blocks */
+    bool configure(uint8_t budget, uint8_t period) {
+        if (not valid(budget, period)) return false;
+        budget_ms = budget;
+        period_ms = period;
+        if (running) job = 0; /* from the start, if already running */
+        return true;
     }
 
+    bool configuring(void) const { return no_job != job; }
+
+    uint8_t get_budget(void) const { return budget_ms; }
+    uint8_t get_period(void) const { return period_ms; }
+
 
     void step(void) {
-        const auto t = sensor.readRangeContinuousMillimeters();
-        if (65535 != t)         // if not timed-out
-            dx = min(t,1200);
+        using namespace jetpack;
+        const uint8_t me = twi::client::rangefinder;
+        if (idle == phase and no_job == job and micros() - t_poll < poll_interval_us) return;
+        if (not twi::claim(me)) return;
+        if (twi::busy()) return;
+        const bool ok = (twi::done == twi::result());
+
+        switch(phase)
+        {
+            case idle: /* poll for new sample */
+                if (no_job != job) { /* the bus is ours and idle */
+                    reconfigure();
+                    break;
+                }
+                twi::read(address, VL53L0X::RESULT_INTERRUPT_STATUS, buf, 1);
+                t_poll = micros();
+                phase = status;
+                break;
+
+            case status:
+                if (ok and (buf[0] & 0x07)) {
+                    twi::read(address, VL53L0X::RESULT_RANGE_STATUS + 10, buf, 2);
+                    phase = result;
+                } else {
+                    phase = idle;
+                    twi::release(me);
+                }
+                break;
+
+            case result:
+                if (ok) {
+                    const uint16_t t = (buf[0] << 8) | buf[1];
+                    dx = min(t,1200);
+                    ++seq;
+                }
+                buf[0] = 0x01;
+                twi::write(address, VL53L0X::SYSTEM_INTERRUPT_CLEAR, buf, 1);
+                phase = clear;
+                break;
+
+            case clear:
+                phase = idle;
+                twi::release(me);
+                break;
+
+            case writing:
+                if (not ok) job = no_job;
+                reconfigure();
+                break;
+        }
 
         /* note: out of range value is 8190
            but sensor can measure slightly above 1200
@@ -31,4 +248,3 @@ public:
     }
 
 };
-
@@ -0,0 +1,184 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_REPORT_HPP
+#define JETPACK_REPORT_HPP
+
+#include "sensorimotor_node.hpp"
+#include "slottimer.hpp"
+#include "checksum.hpp"
+#include "assert.hpp"
+
+namespace jetpack {
+
+/* Fields of the data report, selected by the report mask. The mask is
+   sent as leading bitmap of the payload, fields follow in bit order.
+   If bit 7 is set, a second bitmap byte with extensions follows. */
+namespace report_field {
+	const uint8_t poti_0   = 1<<0; /* 1 byte  */
+	const uint8_t poti_1   = 1<<1; /* 1 byte  */
+	const uint8_t poti_2   = 1<<2; /* 1 byte  */
+	const uint8_t poti_3   = 1<<3; /* 1 byte  */
+	const uint8_t luminous = 1<<4; /* 2 bytes */
+	const uint8_t capacity = 1<<5; /* 2 bytes */
+	const uint8_t distance = 1<<6; /* 2 bytes, msb first */
+	const uint8_t extended = 1<<7; /* second bitmap byte follows */
+	const uint8_t all      = 0x7F;
+}
+
+namespace report_ext {
+	const uint8_t hires     = 1<<0; /* selected potis and luminous as packed 10 bit values */
+	const uint8_t range_seq = 1<<1; /* 1 byte, sample counter of the distance, after all fields */
+	const uint8_t imu       = 1<<2; /* 12 bytes, accel x y z, gyro x y z, msb first */
+	const uint8_t reserved  = 0xF8; /* must be zero */
+}
+
+/* Append 10 bit values as continuous bit stream, msb first, the last
+   byte is padded with zeros. Four values take 5 bytes instead of 8. */
+inline uint8_t pack10(uint8_t* dst, const uint16_t* src, uint8_t num)
+{
+	uint32_t acc  = 0;
+	uint8_t  bits = 0, n = 0;
+	for (uint8_t i = 0; i < num; ++i) {
+		acc   = (acc << 10) | (src[i] & 0x3FF);
+		bits += 10;
+		while (bits >= 8) {
+			bits -= 8;
+			dst[n++] = acc >> bits;
+		}
+	}
+	if (bits)
+		dst[n++] = acc << (8 - bits);
+	return n;
+}
+
+/*
+	Double buffered, precomputed data_response frame.
+
+	The sensors write the payload into the back buffer and publish it,
+	which also precomputes the payload's part of the checksum. On a data
+	request the front frame only needs the id, the byte counter and the
+	checksum patched in and is transmitted from where it is, without
+	copying.
+
+	With the CRC the payload's part is its CRC from state 0 (P). The
+	table step g(x) = crc8_table[x] is linear, so running the payload
+	from the header's state s instead gives P ^ g^L(s), and g^L(s) is
+	the xor of the images g^L(1<<i) of the bits set in s. These eight
+	images depend on the payload length L only and are recomputed when
+	it changes. finalize then takes three table steps (id, N, counter)
+	and up to eight xors instead of the whole frame.
+	If the back buffer is still on the wire, publishing is skipped for
+	this step and the previous front stays valid.
+
+	frame: FF FF C1 <id> <N> <num bytes read> <bitmap(s)> <fields...> <chk>
+*/
+class data_report {
+public:
+	static const uint8_t cmd          = 0xC1; /* 1100.0001 */
+	static const uint8_t num_header   = 6;    /* sync, sync, cmd, id, N, num bytes read */
+	static const uint8_t max_payload  = 27;   /* 2 bitmaps + all fields in hires + range seq + imu */
+	static const uint8_t max_frame    = num_header + max_payload + 1; /* + checksum */
+
+private:
+	uint8_t frame[2][max_frame];
+	uint8_t len[2]  = {0, 0}; /* payload size */
+	uint8_t sum[2]  = {0, 0}; /* checksum of the payload, sum or CRC from 0 */
+	uint8_t front   = 0;
+	uint8_t sent    = 0xFF;   /* index of last frame handed out for transmission */
+
+	bool on_the_wire(uint8_t i) const {
+		return (i == sent) and (rs485::busy() or slottimer::busy());
+	}
+
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+	uint8_t header_crc = 0;       /* state after FF FF C1 */
+	uint8_t image[8];             /* g^L(1<<i) */
+	uint8_t image_len  = 0xFF;    /* L of the images */
+
+	static uint8_t crc(uint8_t s, uint8_t byte) { return pgm_read_byte(&crc8_table[s ^ byte]); }
+
+	void update_images(uint8_t n) {
+		if (n == image_len) return;
+		for (uint8_t i = 0; i < 8; ++i) {
+			uint8_t s = 1 << i;
+			for (uint8_t k = 0; k < n; ++k)
+				s = crc(s, 0);
+			image[i] = s;
+		}
+		image_len = n;
+	}
+#endif
+
+public:
+	data_report()
+	{
+		for (uint8_t i = 0; i < 2; ++i) {
+			for (uint8_t k = 0; k < max_frame; ++k)
+				frame[i][k] = 0;
+			frame[i][0] = 0xFF;
+			frame[i][1] = 0xFF;
+			frame[i][2] = cmd;
+		}
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+		header_crc = crc(crc(crc(0, 0xFF), 0xFF), cmd);
+		update_images(0);
+#endif
+	}
+
+	/* writer: payload of the back buffer or nullptr if it is still being sent */
+	uint8_t* back(void) {
+		const uint8_t b = front ^ 1;
+		return on_the_wire(b) ? nullptr : &frame[b][num_header];
+	}
+
+	void publish(uint8_t payload_size) {
+		assert(payload_size <= max_payload, 45);
+		const uint8_t b = front ^ 1;
+		frame[b][4] = payload_size + 1; /* N includes num bytes read */
+		len[b] = payload_size;
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_ADDITIVE
+		uint8_t s = 0;
+		for (uint8_t i = num_header; i < num_header + payload_size; ++i)
+			s += frame[b][i];
+		sum[b] = s;
+#else
+		uint8_t s = 0;
+		for (uint8_t i = num_header; i < num_header + payload_size; ++i)
+			s = crc(s, frame[b][i]);
+		sum[b] = s;
+		update_images(payload_size);
+#endif
+		front  = b;
+	}
+
+	/* reader: patch in id and counter, returns the complete frame */
+	const uint8_t* finalize(uint8_t id, uint8_t num_bytes_read) {
+		uint8_t* f = frame[front];
+		const uint8_t last = size() - 1;
+		f[3] = id;
+		f[5] = num_bytes_read;
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_ADDITIVE
+		const uint8_t chk = 0xFE + cmd + id + f[4] + num_bytes_read + sum[front];
+		f[last] = ~chk + 1; /* two's complement checksum */
+#else
+		const uint8_t s = crc(crc(crc(header_crc, id), f[4]), num_bytes_read);
+		uint8_t chk = sum[front];
+		for (uint8_t i = 0; i < 8; ++i)
+			if (s & (1 << i)) chk ^= image[i];
+		f[last] = chk;
+#endif
+		sent = front;
+		return f;
+	}
+
+	/* size of the front frame incl. checksum */
+	uint8_t size(void) const { return num_header + len[front] + 1; }
+};
+
+} /* namespace jetpack */
+
+#endif /* JETPACK_REPORT_HPP */
@@ -0,0 +1,116 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_SCHEDULER_HPP
+#define JETPACK_SCHEDULER_HPP
+
+#include <Arduino.h>
+#include "clock.hpp"
+#include "trace.hpp"
+
+/*
+	Cooperative, table driven task scheduler.
+
+	Each task has a period, a time budget and a priority. A task is due
+	when its deadline (last start + period) has passed or when it was
+	released explicitly, e.g. by a data request of the host. Of all due
+	tasks the one with the highest priority (lowest number) runs, among
+	equal priorities the one with the earliest deadline. Tasks are never
+	preempted, hence they must be short. The poll function (communication)
+	runs before every task, so it is never held up by more than one task.
+
+	For every task the longest run time and the number of budget overruns
+	are kept, the host reads them with the diag request. Time base is the
+	clock (timer 1), extended to 32 bit ticks by adding the elapsed time
+	on every step. As the clock wraps every 20 ms, a step (i.e. poll and
+	one task) must take less than that, which the budgets ensure by far.
+	With JETPACK_TRACE the poll function is traced as stage 0 and task i
+	as stage 1 + i.
+*/
+
+namespace jetpack {
+
+struct task {
+	void     (*run)(void);
+	uint32_t period_us;
+	uint16_t budget_us;
+	uint8_t  priority;     /* 0 is highest */
+
+	/* state, zero initialized */
+	uint32_t next;         /* deadline, in clock ticks */
+	bool     released;
+	uint16_t overruns;
+	uint16_t max_us;       /* longest run time */
+};
+
+template <uint8_t NumTasks>
+class scheduler {
+	task* tasks;
+	void  (*poll)(void);
+
+	uint32_t ticks  = 0;   /* extended clock */
+	uint16_t t_last = 0;   /* clock at the last update */
+
+	uint32_t now(void) {
+		const uint16_t t = clock::now();
+		ticks += clock::elapsed(t_last, t);
+		t_last = t;
+		return ticks;
+	}
+
+	static bool is_due(const task& t, uint32_t now) {
+		return t.released or (int32_t) (now - t.next) >= 0;
+	}
+
+	/* higher priority, or same priority and earlier deadline */
+	static bool precedes(const task& a, const task& b) {
+		return (a.priority != b.priority) ? a.priority < b.priority
+		                                  : (int32_t) (a.next - b.next) < 0;
+	}
+
+public:
+	static const uint8_t num_tasks = NumTasks;
+
+	scheduler(task (&table)[NumTasks], void (*poll)(void))
+	: tasks(table)
+	, poll(poll)
+	{}
+
+	void init(void) {
+		t_last = clock::now();
+		for (uint8_t i = 0; i < NumTasks; ++i)
+			tasks[i].next = ticks;
+	}
+
+	/* run the task as soon as possible, regardless of its period */
+	void release(uint8_t i) { tasks[i].released = true; }
+
+	const task& get(uint8_t i) const { return tasks[i]; }
+
+	void step(void) {
+		JETPACK_TRACE_STAGE(0, poll());
+
+		const uint32_t start = now();
+		uint8_t sel = NumTasks;
+		for (uint8_t i = 0; i < NumTasks; ++i)
+			if (is_due(tasks[i], start) and (NumTasks == sel or precedes(tasks[i], tasks[sel])))
+				sel = i;
+		if (NumTasks == sel) return;
+
+		task& t = tasks[sel];
+		t.released = false;
+		t.next = start + t.period_us * clock::ticks_per_us;
+		JETPACK_TRACE_STAGE(1 + sel, t.run());
+
+		const uint32_t dt = (now() - start) / clock::ticks_per_us;
+		if (dt > t.max_us) t.max_us = (dt < 0xffff) ? dt : 0xffff;
+		if (dt > t.budget_us and t.overruns < 0xffff) ++t.overruns;
+	}
+};
+
+} /* namespace jetpack */
+
+#endif /* JETPACK_SCHEDULER_HPP */
@@ -10,6 +10,8 @@
 #define SUPREME_SENDBUFFER_HPP
 
 #include "sensorimotor_node.hpp"
+#include "slottimer.hpp"
+#include "checksum.hpp"
 #include "assert.hpp"
 
 
@@ -19,43 +21,80 @@ namespace jetpack {
 template <unsigned N>
 class sendbuffer {
 	static const unsigned NumSyncBytes = 2;
-	static const uint8_t chk_init = 0xFE; /* (0xff + 0xff) % 256 */
+	static const unsigned NumHeaderBytes = NumSyncBytes + 2; /* + cmd + id */
 	uint16_t  ptr = NumSyncBytes;
 	uint8_t   buffer[N];
-	uint8_t   checksum = chk_init;
+	checksum  chk;
+
+	const uint8_t* frame     = nullptr; /* prebuilt frame, sent instead of the buffer */
+	uint8_t        frame_len = 0;
 public:
 	sendbuffer()
 	{
 		static_assert(N > NumSyncBytes, "Invalid buffer size.");
 		for (uint8_t i = 0; i < NumSyncBytes; ++i)
 			buffer[i] = 0xFF; // init sync bytes once
+		restart_checksum();
 	}
 	void add_byte(uint8_t byte) {
 		assert(ptr < (N-1), 1);
 		buffer[ptr++] = byte;
-		checksum += byte;
+		chk.add(byte);
 	}
 	void add_word(uint16_t word) {
 		add_byte((word  >> 8) & 0xff);
 		add_byte( word        & 0xff);
 	}
-	void discard(void) { ptr = NumSyncBytes; }
+	void discard(void) { ptr = NumSyncBytes; frame = nullptr; restart_checksum(); }
+
+	/* send a complete frame incl. checksum from elsewhere, without copying */
+	void attach(const uint8_t* f, uint8_t len) {
+		assert(ptr == NumSyncBytes, 9);
+		frame     = f;
+		frame_len = len;
+	}
+
 	void flush() {
+		if (frame) {
+			rs485::sendmode();
+			rs485::write(frame, frame_len, NumHeaderBytes);
+			frame = nullptr;
+			return;
+		}
 		if (ptr == NumSyncBytes) return;
 		add_checksum();
 		rs485::sendmode();
-		rs485::write(buffer, ptr);
-		rs485::flush();   //TODO do not wait here, set an flag and check in com step to switch into recv mode again
-		rs485::recvmode();
-		/* prepare next */
+		rs485::write(buffer, ptr, NumHeaderBytes); /* returns immediately, isr switches back to recvmode */
+		/* prepare next, do not add bytes before busy() returns false */
 		ptr = NumSyncBytes;
 	}
-	uint16_t size(void) const { return ptr; }
+	/* transmit delay_us after t_ref (clock ticks), e.g. at the start of a
+	   TDMA slot, returns false if that time has passed, the frame is dropped */
+	bool flush_at(uint16_t t_ref, uint32_t delay_us) {
+		if (frame) {
+			const bool ok = slottimer::start(frame, frame_len, NumHeaderBytes, t_ref, delay_us);
+			frame = nullptr;
+			return ok;
+		}
+		if (ptr == NumSyncBytes) return false;
+		add_checksum();
+		const bool ok = slottimer::start(buffer, ptr, NumHeaderBytes, t_ref, delay_us);
+		ptr = NumSyncBytes;
+		return ok;
+	}
+	bool busy(void) const { return rs485::busy() or slottimer::busy(); }
+	/* number of bytes without checksum */
+	uint16_t size(void) const { return frame ? frame_len - 1 : ptr; }
 private:
 	void add_checksum() {
 		assert(ptr < N, 8);
-		buffer[ptr++] = ~checksum + 1; /* two's complement checksum */
-		checksum = chk_init;
+		buffer[ptr++] = chk.trailer();
+		restart_checksum();
+	}
+	void restart_checksum() {
+		chk.reset();
+		for (uint8_t i = 0; i < NumSyncBytes; ++i)
+			chk.add(0xFF); /* sync bytes are covered too */
 	}
 };
 
@@ -10,6 +10,7 @@
 #define JETPACK_SENSORIMOTOR_NODE_HPP
 
 #include <Arduino.h>
+#include "usart.hpp"
 
 /* motors */
 #define PWM_0 9
@@ -58,8 +59,13 @@ namespace led
     void on(uint8_t pwm = 255) {
         if (pwm == 255)
             digitalWrite(led_pin, HIGH);
-        else
+        else {
+            /* timer 2 is used as slot timer, restore the default phase correct
+               pwm mode first. Only used for blinking in assert(), which never returns. */
+            TCCR2A = (1<<WGM20);
+            TCCR2B = (1<<CS22);
             analogWrite(led_pin, pwm);
+        }
     }
 
     void off() { digitalWrite(led_pin, LOW); }
@@ -93,49 +99,62 @@ namespace button
 namespace rs485
 {
 
-    const uint8_t drive_enable = 13; // DE
-    const uint8_t read_disable = 7;  // NRE
-    const int baudrate = 1000000; // 1 Mbaud
-
+    const uint8_t drive_enable = 13; // DE  (PB5)
+    const uint8_t read_disable = 7;  // NRE (PD7)
+    const uint32_t baudrate = 1000000UL; // 1 Mbaud
+    const uint8_t  byte_time_us = JETPACK_RS485_MPCM ? 11 : 10; // start + 8 or 9 data + stop bits
 
-    void sendmode() {
-        digitalWrite(drive_enable, HIGH);
-        digitalWrite(read_disable, HIGH);
+    /* direct port access, recvmode is called from the tx complete isr */
+    inline void sendmode() {
+        PORTB |= (1<<PB5);
+        PORTD |= (1<<PD7);
     }
 
-    void recvmode() {
-        digitalWrite(drive_enable, LOW);
-        digitalWrite(read_disable, LOW);
+    inline void recvmode() {
+        PORTB &= ~(1<<PB5);
+        PORTD &= ~(1<<PD7);
     }
 
     void init() {
         pinMode(drive_enable, OUTPUT);
         pinMode(read_disable, OUTPUT);
-        Serial.begin(1000000);
+        jetpack::usart::init(baudrate);
         recvmode();
     }
 
-    void flush() { Serial.flush(); }
+    void flush() { jetpack::usart::flush(); }
 
-    void write(const uint8_t* buffer, uint16_t N) {
-        for (uint16_t i = 0; i < N; ++i)
-            Serial.write(buffer[i]);
-    }
+    /* non-blocking, transceiver returns to recvmode when transmission is complete,
+       num_header is the number of leading bytes sent as address frames in MPCM mode */
+    void write(const uint8_t* buffer, uint8_t N, uint8_t num_header = 0) { jetpack::usart::write(buffer, N, num_header); }
 
-    bool read(uint8_t& buffer) {
-        if (Serial.available() > 0) {
-            //led::on();
-            buffer = Serial.read();
-            //led::off();
-            return true;
-        } else {
-            return false;
-        }
-    }
+    void set_address(uint8_t id) { jetpack::usart::set_address(id); }
+
+    bool busy() { return jetpack::usart::busy(); }
+
+    /* number of received bytes not read yet */
+    uint8_t available() { return jetpack::usart::available(); }
+
+    /* bulk read, returns number of bytes copied to buffer */
+    uint8_t read(uint8_t* buffer, uint8_t N) { return jetpack::usart::read(buffer, N); }
+
+    bool read(uint8_t& buffer) { return read(&buffer, 1) > 0; }
+
+    /* ring position of the next byte read, positions count modulo the ring size */
+    uint8_t read_position() { return jetpack::usart::position(); }
+
+    /* arrival time in clock ticks, if the byte at position was the second of a sync pair */
+    bool sync_time(uint8_t position, uint16_t& t) { return jetpack::usart::sync_time(position, t); }
 
 
 } /* namespace rs485 */
 
+ISR(USART_TX_vect)
+{
+    rs485::recvmode();
+    jetpack::usart::tx_finished();
+}
+
 
 
 #endif /* JETPACK_SENSORIMOTOR_NODE_HPP */
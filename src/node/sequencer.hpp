@@ -0,0 +1,134 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef SUPREME_SEQUENCER_HPP
+#define SUPREME_SEQUENCER_HPP
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/*
+	Compile-time channel schedule with per-channel sample rates.
+
+	Usage:
+		typedef sequencer< channel<0,4>, channel<6,1> > seq;
+		pgm_read_byte(&seq::table()[i]), i < seq::length
+
+	Each channel is given a rate weight w. The schedule consists of
+	max(w) rounds, a channel takes part in round r if floor((r+1)w/max)
+	> floor(rw/max), which spreads its w samples evenly over all rounds
+	(Bresenham). Within a round the channels keep the order of the list.
+	Hence the schedule has sum(w) entries and channel c appears exactly
+	w_c times, which is checked by static_asserts below.
+
+	Example: potis 4x, brightness 1x
+		p0 p1 p2 p3 | p0 p1 p2 p3 | p0 p1 p2 p3 | p0 p1 p2 p3 b0 b1
+*/
+
+namespace supreme {
+
+template <uint8_t Channel, uint8_t Weight>
+struct channel {
+	static const uint8_t id     = Channel;
+	static const uint8_t weight = Weight;
+	static_assert(Weight > 0, "Channel weight must be at least one.");
+};
+
+namespace detail {
+
+	constexpr bool in_round(uint8_t w, uint8_t r, uint8_t m) {
+		return ((r + 1) * w) / m > (r * w) / m;
+	}
+
+	/* recursion over the channel list */
+	template <typename... Cs> struct channels;
+
+	template <> struct channels<> {
+		static constexpr uint8_t sum  (void)                         { return 0; }
+		static constexpr uint8_t peak (void)                         { return 0; }
+		static constexpr uint8_t count(uint8_t, uint8_t)             { return 0; }
+		static constexpr uint8_t pick (uint8_t, uint8_t, uint8_t)    { return 0xFF; }
+		static constexpr uint8_t weight_of(uint8_t)                  { return 0; }
+	};
+
+	template <typename C, typename... Cs>
+	struct channels<C, Cs...> {
+		typedef channels<Cs...> rest;
+
+		static constexpr uint8_t sum(void) { return C::weight + rest::sum(); }
+
+		static constexpr uint8_t peak(void) {
+			return (C::weight > rest::peak()) ? C::weight : rest::peak();
+		}
+
+		/* number of channels taking part in round r */
+		static constexpr uint8_t count(uint8_t r, uint8_t m) {
+			return (in_round(C::weight, r, m) ? 1 : 0) + rest::count(r, m);
+		}
+
+		/* k-th channel taking part in round r */
+		static constexpr uint8_t pick(uint8_t k, uint8_t r, uint8_t m) {
+			return !in_round(C::weight, r, m) ? rest::pick(k, r, m)
+			     : (0 == k)                   ? C::id
+			     :                              rest::pick(k - 1, r, m);
+		}
+
+		static constexpr uint8_t weight_of(uint8_t id) {
+			return (C::id == id) ? C::weight + rest::weight_of(id) : rest::weight_of(id);
+		}
+	};
+
+	/* index sequence for building the table */
+	template <uint8_t... I> struct indices {};
+	template <uint8_t N, uint8_t... I> struct make_indices : make_indices<N - 1, N - 1, I...> {};
+	template <uint8_t... I> struct make_indices<0, I...> { typedef indices<I...> type; };
+
+	template <typename Seq, typename Idx> struct table;
+	template <typename Seq, uint8_t... I>
+	struct table<Seq, indices<I...> > {
+		static const uint8_t value[sizeof...(I)];
+	};
+	template <typename Seq, uint8_t... I>
+	const uint8_t table<Seq, indices<I...> >::value[sizeof...(I)] PROGMEM = { Seq::entry(I)... };
+
+} /* namespace detail */
+
+template <typename... Cs>
+struct sequencer {
+	typedef detail::channels<Cs...> list;
+
+	static const uint8_t length = list::sum();
+	static const uint8_t rounds = list::peak();
+
+	/* i-th entry of the schedule, searching from round r */
+	static constexpr uint8_t entry(uint8_t i, uint8_t r = 0) {
+		return (r >= rounds)                 ? 0xFF
+		     : (i < list::count(r, rounds))  ? list::pick(i, r, rounds)
+		     :                                 entry(i - list::count(r, rounds), r + 1);
+	}
+
+	/* number of occurrences of a channel in the schedule */
+	static constexpr uint8_t occurrences(uint8_t id, uint8_t i = 0) {
+		return (i >= length) ? 0 : ((entry(i) == id) ? 1 : 0) + occurrences(id, i + 1);
+	}
+
+	/* every entry is a valid channel and appears as often as its weight */
+	static constexpr bool valid(uint8_t i = 0) {
+		return (i >= length) ? true
+		     : (entry(i) < 8) and (occurrences(entry(i)) == list::weight_of(entry(i))) and valid(i + 1);
+	}
+
+	/* schedule in flash, read with pgm_read_byte */
+	static const uint8_t* table(void) {
+		static_assert(length > 0, "Empty channel schedule.");
+		static_assert(valid(), "Invalid channel schedule.");
+		return detail::table<sequencer, typename detail::make_indices<length>::type>::value;
+	}
+};
+
+} /* namespace supreme */
+
+#endif /* SUPREME_SEQUENCER_HPP */
@@ -0,0 +1,108 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_SLOTTIMER_HPP
+#define JETPACK_SLOTTIMER_HPP
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "sensorimotor_node.hpp"
+#include "clock.hpp"
+
+/*
+	One-shot timer for time-slotted (TDMA) responses.
+
+	Timer 2 runs in normal mode with prescaler 8 (0.5 µs per tick,
+	wrap-around every 128 µs). Compare unit B is used as a one-shot:
+	the delay is split into the remainder and full timer periods, the
+	ISR counts down the periods and then starts the transmission of the
+	frame handed over to start(). In normal mode OCR2B is not double
+	buffered, other than in the PWM modes of timer 0 and 1.
+
+	The delay counts from a reference time on the clock (timer 1, same
+	tick), e.g. the arrival of a request, the time already passed since
+	is subtracted. Arming is done with interrupts blocked, so no ISR can
+	get between reading the timer and setting the compare value, which
+	would let the match slip by a full timer period.
+
+	Note: timer 2 is no longer available for analogWrite on pin 11/3.
+*/
+
+namespace jetpack {
+namespace slottimer {
+
+	const uint8_t min_ticks = 4; /* shorter remainders could be missed */
+
+	static_assert(2 == clock::ticks_per_us, "Timer 2 and the clock must tick alike.");
+
+	/* registers changed by isr */
+	volatile uint16_t periods = 0;
+	volatile bool     pending = false;
+
+	const uint8_t*    frame     = nullptr;
+	uint8_t           frame_len = 0;
+	uint8_t           frame_hdr = 0;
+
+	inline void init(void) {
+		TIMSK2 = 0;
+		TCCR2A = 0;           // normal mode
+		TCCR2B = (1<<CS21);   // prescaler 8
+	}
+
+	inline bool busy(void) { return pending; }
+
+	/* Transmit the buffer delay_us after t_ref (clock ticks, less than
+	   one clock period ago). Returns false and sends nothing if that time
+	   has already passed. The buffer must stay untouched until sent. */
+	inline bool start(const uint8_t* buffer, uint8_t len, uint8_t num_header, uint16_t t_ref, uint32_t delay_us) {
+		const uint32_t ticks = delay_us * clock::ticks_per_us;
+
+		uint8_t sreg = SREG;
+		cli();
+		const uint16_t passed = clock::elapsed(t_ref, clock::now_isr());
+		if ((uint32_t) passed + min_ticks > ticks) {
+			SREG = sreg;
+			return false;      // too late
+		}
+		const uint32_t left = ticks - passed;
+		uint8_t rest = left & 0xFF;
+		if (rest < min_ticks) rest = min_ticks;
+
+		frame     = buffer;
+		frame_len = len;
+		frame_hdr = num_header;
+		periods   = left >> 8;
+		pending   = true;
+
+		OCR2B  = TCNT2 + rest;
+		TIFR2  = (1<<OCF2B);   // clear stale match
+		TIMSK2 = (1<<OCIE2B);
+		SREG   = sreg;
+		return true;
+	}
+
+	inline void cancel(void) {
+		TIMSK2  = 0;
+		pending = false;
+	}
+
+} /* namespace slottimer */
+} /* namespace jetpack */
+
+ISR(TIMER2_COMPB_vect)
+{
+	using namespace jetpack::slottimer;
+	if (periods) {           // fires again after a full period
+		--periods;
+		return;
+	}
+	TIMSK2 = 0;
+	rs485::sendmode();
+	rs485::write(frame, frame_len, frame_hdr);
+	pending = false;         // usart is busy from now on
+}
+
+#endif /* JETPACK_SLOTTIMER_HPP */
@@ -0,0 +1,83 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_TRACE_HPP
+#define JETPACK_TRACE_HPP
+
+#include <stdint.h>
+#include "clock.hpp"
+
+/* Set to 1 to measure the run time of the loop's stages. With 0 the
+   probes compile to the bare statement. */
+#ifndef JETPACK_TRACE
+#define JETPACK_TRACE 1
+#endif
+
+/*
+	Run time statistics of the main loop's stages.
+
+	A probe takes the time of a statement with the timer 1 clock (0.5 µs
+	ticks, no pin toggling, no scope needed) and keeps minimum, maximum
+	and mean per stage. The statistics are read (and restarted) with the
+	stats_request command. Stages are numbered by the caller, e.g. the
+	scheduler uses 0 for communication and 1 + i for task i.
+
+	Usage:
+		JETPACK_TRACE_STAGE(stage, statement);
+*/
+
+#if JETPACK_TRACE
+
+namespace jetpack {
+namespace trace {
+
+	const uint8_t num_stages = 8;
+
+	struct stats {
+		uint16_t min;   /* ticks */
+		uint16_t max;
+		uint32_t sum;
+		uint16_t count;
+
+		uint16_t mean(void) const { return count ? sum / count : 0; }
+	};
+
+	stats   stage[num_stages];
+	uint8_t num_used = 0;
+
+	inline void reset(void) {
+		for (uint8_t i = 0; i < num_stages; ++i)
+			stage[i] = stats();
+	}
+
+	inline void record(uint8_t i, uint16_t ticks) {
+		if (i >= num_stages) return;
+		if (i >= num_used) num_used = i + 1;
+		stats& s = stage[i];
+		if (0 == s.count or ticks < s.min) s.min = ticks;
+		if (ticks > s.max) s.max = ticks;
+		if (0xffff == s.count) { /* keep the mean, halve the weight */
+			s.sum   >>= 1;
+			s.count >>= 1;
+		}
+		s.sum += ticks;
+		++s.count;
+	}
+
+} /* namespace trace */
+} /* namespace jetpack */
+
+#define JETPACK_TRACE_STAGE(i, statement)                                   \
+	do {                                                                    \
+		const uint16_t trace_begin_ = jetpack::clock::now();                \
+		statement;                                                          \
+		jetpack::trace::record((i), jetpack::clock::since(trace_begin_));   \
+	} while (0)
+#else
+#define JETPACK_TRACE_STAGE(i, statement) statement
+#endif
+
+#endif /* JETPACK_TRACE_HPP */
@@ -0,0 +1,232 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_TWI_HPP
+#define JETPACK_TWI_HPP
+
+#include <avr/io.h>
+#include "clock.hpp"
+
+/*
+	Non-blocking I2C (TWI) master, polled from the main loop.
+
+	One register transaction at a time: write the register address and
+	then either write data or read data after a repeated start. A call of
+	step() handles the bus events (TWINT) of the transaction as they come
+	up, for at most step_budget_ticks: at 400 kHz (set by init()) a byte
+	takes 22.5us, so
+	a short transaction completes within one step instead of taking one
+	loop iteration per event. If the transaction takes longer, it goes on
+	in the next step, the hardware holds the bus (clock stretching)
+	meanwhile.
+
+	Wire owns the TWI interrupt vector, hence the TWI interrupt stays
+	disabled while a transaction is running here. Blocking calls through
+	Wire (e.g. sensor setup) must not overlap with this engine.
+
+	Several devices share the bus through claim() and release(): a client
+	owns the bus for a job of one or more transactions and releases it
+	when done. If others are waiting, the last owner has to wait for its
+	next turn (round robin), so no device can starve another.
+*/
+
+namespace jetpack {
+namespace twi {
+
+	const uint32_t scl_hz            = 400000;
+	const uint8_t  bitrate           = ((F_CPU / scl_hz) - 16) / 2; /* TWBR, prescaler 1 */
+	const uint16_t timeout_ticks     = 5000 * clock::ticks_per_us; /* 5ms */
+	const uint16_t step_budget_ticks =   80 * clock::ticks_per_us; /* within the i2c task's budget */
+
+	enum result_t { idle, running, done, failed };
+
+	/* status codes, TWSR & 0xF8 */
+	enum status_t {
+		  start_sent     = 0x08
+		, restart_sent   = 0x10
+		, sla_w_ack      = 0x18
+		, data_w_ack     = 0x28
+		, sla_r_ack      = 0x40
+		, data_r_ack     = 0x50
+		, data_r_nack    = 0x58
+	};
+
+	uint8_t   address  = 0;
+	uint8_t   reg      = 0;
+	uint8_t*  data     = nullptr;
+	uint8_t   len      = 0;
+	uint8_t   pos      = 0;
+	bool      reading  = false;
+	bool      reg_sent = false;
+	result_t  state    = idle;
+	uint16_t  t_begin  = 0;
+	uint16_t  errors   = 0;
+
+	/* bus arbitration */
+	const uint8_t no_owner = 0xFF;
+	uint8_t   owner    = no_owner;
+	uint8_t   last     = no_owner;
+	uint8_t   waiting  = 0; /* bit per client */
+
+	namespace client { /* ids of the devices on the bus */
+		const uint8_t rangefinder = 0;
+		const uint8_t imu         = 1;
+	}
+
+	/* before any device is set up, also for the blocking calls through
+	   Wire, which keeps the rate as long as its begin() is not called */
+	inline void init(void) {
+		DDRC  &= ~((1<<PC4) | (1<<PC5));
+		PORTC |=  (1<<PC4) | (1<<PC5); /* pull-ups of SDA and SCL */
+		TWSR   = 0;                     /* prescaler 1 */
+		TWBR   = bitrate;
+		TWCR   = (1<<TWEN);
+	}
+
+	inline void command(uint8_t bits) { TWCR = (1<<TWINT) | (1<<TWEN) | bits; }
+
+	inline void stop(result_t r) {
+		command(1<<TWSTO);
+		state   = r;
+		t_begin = clock::now(); /* of the stop condition */
+		if (failed == r and errors < 0xffff) ++errors;
+	}
+
+	inline void reset(void) {
+		TWCR = 0; /* reset the hardware */
+		TWCR = (1<<TWEN);
+		if (errors < 0xffff) ++errors;
+	}
+
+	/* stop condition still pending from the last transaction? If it does
+	   not get out (bus held low), the hardware is reset after the timeout. */
+	inline bool bus_free(void) {
+		if (not (TWCR & (1<<TWSTO))) return true;
+		if (running != state and clock::since(t_begin) > timeout_ticks) {
+			reset();
+			return true;
+		}
+		return false;
+	}
+
+	inline bool busy(void) { return running == state or not bus_free(); }
+
+	inline void begin(uint8_t addr, uint8_t r, uint8_t* buffer, uint8_t num, bool read) {
+		address  = addr;
+		reg      = r;
+		data     = buffer;
+		len      = num;
+		pos      = 0;
+		reading  = read;
+		reg_sent = false;
+		state    = running;
+		t_begin  = clock::now();
+		command(1<<TWSTA);
+	}
+
+	/* buffer must stay valid until the transaction is finished */
+	inline void read (uint8_t addr, uint8_t r, uint8_t* buffer, uint8_t num) { begin(addr, r, buffer, num, true ); }
+	inline void write(uint8_t addr, uint8_t r, uint8_t* buffer, uint8_t num) { begin(addr, r, buffer, num, false); }
+
+	/* returns true if the client owns the bus */
+	inline bool claim(uint8_t client) {
+		if (owner == client) return true;
+		waiting |= (1<<client);
+		if (no_owner != owner or busy()) return false;
+		if (last == client and (waiting & ~(1<<client))) return false; /* others first */
+		owner    = client;
+		waiting &= ~(1<<client);
+		return true;
+	}
+
+	inline void release(uint8_t client) {
+		if (owner != client) return;
+		owner = no_owner;
+		last  = client;
+	}
+
+	/* result of the last transaction, done or failed is reported once */
+	inline result_t result(void) {
+		const result_t r = state;
+		if (done == r or failed == r) state = idle;
+		return r;
+	}
+
+	/* handles one bus event, if there is one */
+	inline void event(void) {
+		if (not (TWCR & (1<<TWINT))) {
+			if (clock::since(t_begin) > timeout_ticks) {
+				reset();
+				state = failed;
+			}
+			return;
+		}
+
+		switch(TWSR & 0xF8)
+		{
+			case start_sent:
+				TWDR = address << 1; /* write */
+				command(0);
+				break;
+
+			case restart_sent:
+				TWDR = (address << 1) | 1; /* read */
+				command(0);
+				break;
+
+			case sla_w_ack:
+			case data_w_ack:
+				if (not reg_sent) {
+					TWDR = reg;
+					reg_sent = true;
+					command(0);
+				}
+				else if (reading)
+					command(1<<TWSTA); /* repeated start */
+				else if (pos < len) {
+					TWDR = data[pos++];
+					command(0);
+				}
+				else stop(done);
+				break;
+
+			case sla_r_ack: /* acknowledge all but the last byte */
+				command((len > 1) ? (1<<TWEA) : 0);
+				break;
+
+			case data_r_ack:
+				data[pos++] = TWDR;
+				command((pos + 1 < len) ? (1<<TWEA) : 0);
+				break;
+
+			case data_r_nack:
+				data[pos++] = TWDR;
+				stop(done);
+				break;
+
+			default: /* nack or arbitration lost */
+				stop(failed);
+				break;
+		}
+	}
+
+	/* runs the transaction until it is finished or the budget, counted
+	   from t_start, is spent */
+	inline void step(uint16_t t_start = clock::now()) {
+		while (running == state and clock::since(t_start) < step_budget_ticks)
+			event();
+	}
+
+	/* blocking, only for setup, when no other client is active */
+	inline result_t wait(void) {
+		while (running == state) step();
+		return result();
+	}
+
+} /* namespace twi */
+} /* namespace jetpack */
+
+#endif /* JETPACK_TWI_HPP */
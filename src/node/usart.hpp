@@ -0,0 +1,294 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_USART_HPP
+#define JETPACK_USART_HPP
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include "clock.hpp"
+
+/* Set to 1 to use 9 bit frames with hardware address filtering (multi-
+   processor communication mode) instead of the default 8N1 protocol.
+   All nodes and the host on a bus must use the same setting. */
+#ifndef JETPACK_RS485_MPCM
+#define JETPACK_RS485_MPCM 0
+#endif
+
+/*
+	Minimal USART0 driver replacing Arduino's HardwareSerial.
+
+	The Serial object must NOT be referenced anywhere in the sketch,
+	otherwise the core's HardwareSerial0 is linked in and its
+	USART_RX_vect collides with the one defined here.
+
+	Transmission is driven by the data register empty (UDRE) interrupt,
+	the transmit complete (TXC) interrupt signals when the last bit has
+	left the wire so the transceiver can be switched back.
+
+	Receiving is done by a lean ISR which pushes the bytes into a
+	power-of-two single-producer/single-consumer ring. The ISR is the
+	only writer of rx_head, the main loop the only writer of rx_tail,
+	both are 8 bit and hence atomic on AVR, so no locking is needed.
+
+	The ISR also takes the arrival time of each sync pair (FF FF), i.e.
+	of each frame start, from the clock. The last few are kept together
+	with the ring index of the second sync byte, so responses can be
+	timed relative to a request no matter how late it is parsed. In MPCM
+	mode only address frames count, FF FF in a payload never evicts the
+	stamp of a real frame start.
+
+	At 1 Mbaud a byte arrives every 10 µs (160 cycles), the RX ISR must
+	take only a fraction of that. Besides storing the byte it counts
+	receive errors and, in MPCM mode, runs the address filter. Worst case
+	per byte, hand counted with the cycle times of the AVR instruction
+	set manual for the code avr-gcc -Os is expected to emit (not taken
+	from a listing, redo the count when adding to the ISR):
+
+	                                           8N1     MPCM
+	  response, jmp, prologue, epilogue, reti   ~50     ~50
+	  status, errors, UDR0, ring, rx_last       ~40     ~40
+	  RXB8 and address filter                     -     ~15..25
+	  sync pair stamp (TCNT1, stamps[])         ~22     ~22
+	  worst case                               ~110    ~125
+
+	The MPCM worst case is a sync byte (short filter path) completing a
+	pair; an id byte takes the long filter path but is never stamped.
+	Data frames not for this node do not enter the ISR at all. Both
+	stay below the 160 cycles, with the two byte receive buffer of the
+	USART covering another ISR holding this one off for up to a byte.
+
+	Multi-processor communication mode (JETPACK_RS485_MPCM):
+	The frame header, i.e. sync bytes, command and id, is sent as
+	address frames (9th bit set), the payload as data frames. With MPCM
+	set the USART discards all data frames in hardware. The RX ISR
+	watches the address frames and clears MPCM only if the id matches
+	our own, so payload addressed to other nodes never reaches the
+	ring, nor costs any ISR time. The next sync byte sets MPCM again.
+	Broadcast commands (1011.xxxx) clear MPCM on the command byte.
+*/
+
+namespace jetpack {
+namespace usart {
+
+	const uint8_t rx_size = 128; /* ~1.3 ms of traffic at 1 Mbaud */
+	const uint8_t rx_mask = rx_size - 1;
+
+	static_assert((rx_size & rx_mask) == 0, "RX ring size must be a power of two.");
+
+	/* registers changed by isr */
+	uint8_t          rx_buffer[rx_size];
+	volatile uint8_t rx_head = 0;
+
+	/* registers changed by main loop */
+	volatile uint8_t rx_tail = 0;
+
+	/* arrival times of the last sync pairs, changed by isr */
+	const uint8_t num_stamps = 4;
+	const uint8_t no_index   = 0xFF;
+
+	static_assert((num_stamps & (num_stamps - 1)) == 0, "Number of stamps must be a power of two.");
+
+	struct stamp_t {
+		uint8_t  index; /* ring index of the second sync byte */
+		uint16_t time;  /* clock ticks */
+	};
+
+	stamp_t          stamps[num_stamps];
+	uint8_t          stamp_next = 0;
+	uint8_t          rx_last    = 0; /* previous byte */
+
+	/* receive error counters, free running, changed by isr */
+	volatile uint8_t rx_overruns       = 0; /* hardware data overrun */
+	volatile uint8_t rx_frame_errors   = 0; /* stop bit missing */
+	volatile uint8_t rx_ring_overflows = 0; /* ring full, byte dropped */
+
+	inline void barrier(void) { asm volatile("" ::: "memory"); }
+
+#if JETPACK_RS485_MPCM
+	/* registers used by isr for address filtering */
+	volatile uint8_t own_id = 127;
+	uint8_t          hdr_bytes = 0; /* address bytes received since last sync byte */
+
+	const uint8_t    broadcast_mask = 0xF0;
+	const uint8_t    broadcast_cmds = 0xB0;
+
+	inline void set_mpcm(bool listen_to_addr_only) {
+		/* write zeros to the flags, keep double speed */
+		UCSR0A = (1<<U2X0) | (listen_to_addr_only ? (1<<MPCM0) : 0);
+	}
+
+	inline void address_filter(uint8_t byte) {
+		if (0xFF == byte) {           // sync byte, a new frame starts
+			hdr_bytes = 0;
+			set_mpcm(true);
+			return;
+		}
+		++hdr_bytes;                  // header is: cmd, id
+		if ((1 == hdr_bytes && broadcast_cmds == (byte & broadcast_mask))
+		 || (2 == hdr_bytes && byte == own_id))
+			set_mpcm(false);          // frame is for us, receive the payload
+	}
+#endif
+
+	inline void set_address(uint8_t id) {
+#if JETPACK_RS485_MPCM
+		own_id = id;
+#else
+		(void) id;
+#endif
+	}
+
+	inline void init(uint32_t baudrate) {
+		for (uint8_t k = 0; k < num_stamps; ++k)
+			stamps[k].index = no_index;
+		/* double speed mode, for 1 Mbaud at 16 MHz this gives UBRR = 1 (0% error) */
+		UCSR0A = (1<<U2X0);
+		UBRR0  = (F_CPU / 4 / baudrate - 1) / 2;
+		UCSR0C = (1<<UCSZ01) | (1<<UCSZ00); /* 8N1 */
+		UCSR0B = (1<<RXEN0) | (1<<TXEN0) | (1<<RXCIE0);
+#if JETPACK_RS485_MPCM
+		UCSR0B |= (1<<UCSZ02);                /* 9N1 */
+		set_mpcm(true);
+#endif
+	}
+
+	/* ring index of the next byte read() returns */
+	inline uint8_t position(void) { return rx_tail; }
+
+	/* arrival time of the byte at ring index i, if it was the second byte
+	   of a sync pair, which is still among the last num_stamps ones */
+	inline bool sync_time(uint8_t i, uint16_t& t) {
+		i &= rx_mask;
+		bool found = false;
+		uint8_t sreg = SREG;
+		cli();
+		for (uint8_t k = 0; k < num_stamps; ++k) { /* oldest first */
+			const stamp_t& s = stamps[(stamp_next + k) & (num_stamps - 1)];
+			if (s.index == i) {
+				t = s.time;
+				found = true;
+			}
+		}
+		SREG = sreg;
+		return found;
+	}
+
+	/* number of bytes waiting in the ring */
+	inline uint8_t available(void) { return (rx_head - rx_tail) & rx_mask; }
+
+	/* drain up to n bytes from the ring into dst, returns the number of bytes read */
+	inline uint8_t read(uint8_t* dst, uint8_t n) {
+		const uint8_t head = rx_head;
+		uint8_t tail = rx_tail;
+		uint8_t i = 0;
+		barrier(); /* do not touch the buffer before head was read */
+		while (i < n && tail != head) {
+			dst[i++] = rx_buffer[tail];
+			tail = (tail + 1) & rx_mask;
+		}
+		barrier();
+		rx_tail = tail;
+		return i;
+	}
+
+	/* transmission state, pointer and counter are advanced by the udre isr */
+	const uint8_t*   tx_ptr  = nullptr;
+	volatile uint8_t tx_left = 0;
+	volatile uint8_t tx_addr = 0; /* leading bytes to be sent as address frames */
+	volatile bool    tx_busy = false;
+
+	inline void clear_tx_complete(void) {
+		/* TXC is cleared by writing a one, keep the config bits, write zeros to the error flags */
+		UCSR0A = (UCSR0A & ((1<<U2X0) | (1<<MPCM0))) | (1<<TXC0);
+	}
+
+	/* true from start of write() until the last bit has left the wire */
+	inline bool busy(void) { return tx_busy; }
+
+	/* Start transmission of n bytes and return immediately. The buffer
+	   must not be touched until busy() returns false again. The first
+	   num_addr bytes are sent as address frames in 9 bit mode. */
+	inline void write(const uint8_t* src, uint8_t n, uint8_t num_addr = 0) {
+		if (0 == n) return;
+		tx_ptr  = src;
+		tx_left = n;
+		tx_addr = num_addr;
+		tx_busy = true;
+		UCSR0B |= (1<<UDRIE0); /* udre isr loads the bytes */
+	}
+
+	/* called by the tx complete isr */
+	inline void tx_finished(void) {
+		UCSR0B &= ~(1<<TXCIE0);
+		tx_busy = false;
+	}
+
+	/* wait until the last bit has left the shift register */
+	inline void flush(void) { while (tx_busy); }
+
+} /* namespace usart */
+} /* namespace jetpack */
+
+ISR(USART_RX_vect)
+{
+	using namespace jetpack::usart;
+	const uint8_t status = UCSR0A;            // must be read before UDR0
+	if (status & (1<<DOR0)) ++rx_overruns;
+	if (status & (1<<FE0))  ++rx_frame_errors;
+#if JETPACK_RS485_MPCM
+	const bool is_addr = UCSR0B & (1<<RXB80); // must be read before UDR0
+	const uint8_t byte = UDR0;
+	if (is_addr) address_filter(byte);
+	const bool may_sync = is_addr;            // only the header starts a frame
+#else
+	const uint8_t byte = UDR0;
+	const bool may_sync = true;
+#endif
+	const uint8_t head = rx_head;
+	const uint8_t next = (head + 1) & rx_mask;
+	if (next != rx_tail) {      // drop byte if ring is full
+		rx_buffer[head] = byte;
+		if (may_sync && 0xFF == byte && 0xFF == rx_last) { // sync pair, a frame starts
+			stamp_t& s = stamps[stamp_next];
+			s.index    = head;
+			s.time     = jetpack::clock::now_isr();
+			stamp_next = (stamp_next + 1) & (num_stamps - 1);
+		}
+		barrier();              // publish data before index
+		rx_head = next;
+	}
+	else ++rx_ring_overflows;
+	rx_last = byte;
+}
+
+ISR(USART_UDRE_vect)
+{
+	using namespace jetpack::usart;
+#if JETPACK_RS485_MPCM
+	if (tx_addr) {
+		UCSR0B |= (1<<TXB80);
+		--tx_addr;
+	} else
+		UCSR0B &= ~(1<<TXB80);
+#endif
+	if (1 == tx_left) {
+		/* last byte: clear a TXC possibly left over from an earlier gap
+		   before loading UDR, then wait for the tx complete interrupt */
+		clear_tx_complete();
+		UDR0 = *tx_ptr;
+		UCSR0B = (UCSR0B & ~(1<<UDRIE0)) | (1<<TXCIE0);
+	} else {
+		UDR0 = *tx_ptr;
+	}
+	++tx_ptr;
+	--tx_left;
+}
+
+/* USART_TX_vect is defined by the owner of the transceiver, see rs485 */
+
+#endif /* JETPACK_USART_HPP */
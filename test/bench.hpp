@@ -0,0 +1,32 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_BENCH_HPP
+#define JETPACK_BENCH_HPP
+
+#include <chrono>
+
+/* Host run time of a call, best of several rounds. Only the ratio of two
+   variants carries over to the AVR, not the absolute numbers. */
+
+namespace bench {
+
+	template <typename F>
+	double ns_per_call(F f, unsigned num_calls = 1000000, unsigned num_rounds = 5) {
+		double best = 1e30;
+		for (unsigned r = 0; r < num_rounds; ++r) {
+			const auto t0 = std::chrono::steady_clock::now();
+			for (unsigned i = 0; i < num_calls; ++i) f();
+			const auto t1 = std::chrono::steady_clock::now();
+			const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / num_calls;
+			if (ns < best) best = ns;
+		}
+		return best;
+	}
+
+} /* namespace bench */
+
+#endif /* JETPACK_BENCH_HPP */
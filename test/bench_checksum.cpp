@@ -0,0 +1,92 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Cost per byte of the frame checks: the additive sum, CRC-8/MAXIM bit
+	by bit and the table driven CRC-8 the firmware uses (built with
+	JETPACK_CHECKSUM=1). Each over a 64 byte frame.
+
+	The host times only rank the variants. The AVR cycles are hand
+	counted from the instruction sequences noted at each variant (cycle
+	times of the AVR instruction set manual, the code avr-gcc is
+	expected to emit, not taken from a listing). They leave out what all
+	three share per byte: ld r25, X+ (2) and the loop, dec + brne (3).
+*/
+
+#include <stdio.h>
+#include "bench.hpp"
+#include "checksum.hpp"
+
+using namespace jetpack;
+
+const unsigned len = 64;
+uint8_t frame[len];
+volatile uint8_t sink;
+
+/*	add  r24, r25                    1
+
+	1 cycle per byte, ~10 bytes of flash */
+const unsigned avr_additive = 1;
+
+__attribute__((noinline)) uint8_t additive(const uint8_t* p)
+{
+	uint8_t sum = 0;
+	for (unsigned i = 0; i < len; ++i) sum += p[i];
+	return ~sum + 1;
+}
+
+/*	eor  r24, r25                    1    once per byte
+	8 times, with r18 = 8, r19 = 0x8C:
+	lsr  r24                         1    lsb into carry
+	brcc 1f                          1/2
+	eor  r24, r19                    1/-
+1:	dec  r18                         1
+	brne                             2
+
+	1 + 8 * 6 = 49 cycles per byte, ~20 bytes of flash */
+const unsigned avr_crc8_bitwise = 49;
+
+__attribute__((noinline)) uint8_t crc8_bitwise(const uint8_t* p)
+{
+	uint8_t crc = 0;
+	for (unsigned i = 0; i < len; ++i) {
+		crc ^= p[i];
+		for (uint8_t b = 0; b < 8; ++b)
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+	}
+	return crc;
+}
+
+/*	eor  r30, r25                    1    index = crc ^ byte
+	ldi  r31, 0                      1
+	subi r30, lo8(-(crc8_table))     1    Z = table + index
+	sbci r31, hi8(-(crc8_table))     1
+	lpm  r30, Z                      3
+
+	7 cycles per byte, 256 bytes of flash for the table */
+const unsigned avr_crc8_table = 7;
+
+__attribute__((noinline)) uint8_t crc8_table_driven(const uint8_t* p)
+{
+	checksum chk;
+	for (unsigned i = 0; i < len; ++i) chk.add(p[i]);
+	return chk.trailer();
+}
+
+int main()
+{
+	for (unsigned i = 0; i < len; ++i) frame[i] = i * 37;
+
+	const double add = bench::ns_per_call([]() { sink = additive(frame); }, 200000) / len;
+	const double bit = bench::ns_per_call([]() { sink = crc8_bitwise(frame); }, 200000) / len;
+	const double tab = bench::ns_per_call([]() { sink = crc8_table_driven(frame); }, 200000) / len;
+
+	printf("frame check (host, ns/byte, relative only): additive %.2f, crc8 bitwise %.2f, crc8 table %.2f\n",
+	       add, bit, tab);
+	printf("frame check (AVR, hand counted cycles/byte, + 5 for ld and loop): additive %u, crc8 bitwise %u, crc8 table %u\n",
+	       avr_additive, avr_crc8_bitwise, avr_crc8_table);
+	return 0;
+}
@@ -0,0 +1,94 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Work between a parsed data_request and the first byte handed to the
+	USART: the frame built byte by byte with the sensor getters, as before
+	the data_report, against patching the precomputed frame. Built with
+	JETPACK_CHECKSUM=1 as well (bench_report_crc), where the patched CRC
+	is derived from the one precomputed at publish.
+
+	Both end in flush(), which starts the interrupt driven transmission.
+	The getters are kept out of line as they are on the node, where they
+	live in another class.
+*/
+
+#include <stdio.h>
+#include "bench.hpp"
+#include "sendbuffer.hpp"
+#include "report.hpp"
+
+using namespace jetpack;
+
+struct sensors {
+	uint8_t pos[4] = {1, 2, 3, 4}, lum[2] = {5, 6}, cap[2] = {7, 8};
+	uint16_t dist = 0x1234;
+
+	__attribute__((noinline)) uint8_t  get_position(uint8_t i) const { return pos[i]; }
+	__attribute__((noinline)) uint8_t  get_luminous(uint8_t i) const { return lum[i]; }
+	__attribute__((noinline)) uint8_t  get_capacity(uint8_t i) const { return cap[i]; }
+	__attribute__((noinline)) uint16_t get_distance(void)      const { return dist; }
+};
+
+sensors           ux;
+sendbuffer<64>    send;
+data_report       report;
+volatile uint8_t  motor_id = 7, num_bytes_read = 0;
+
+void tx_done(void)
+{
+	usart::tx_finished();
+	UCSR0B.value = 0;
+}
+
+__attribute__((noinline)) void respond_built(void)
+{
+	const uint8_t exp_num_data_bytes = 11;
+	send.add_byte(0xC1);
+	send.add_byte(motor_id);
+	send.add_byte(exp_num_data_bytes);
+	send.add_byte(num_bytes_read);
+	send.add_byte(ux.get_position(0));
+	send.add_byte(ux.get_position(1));
+	send.add_byte(ux.get_position(2));
+	send.add_byte(ux.get_position(3));
+	send.add_byte(ux.get_luminous(0));
+	send.add_byte(ux.get_luminous(1));
+	send.add_byte(ux.get_capacity(0));
+	send.add_byte(ux.get_capacity(1));
+	send.add_word(ux.get_distance());
+	assert(send.size() == exp_num_data_bytes + 5, 0x7F);
+	send.flush();
+}
+
+__attribute__((noinline)) void respond_precomputed(void)
+{
+	send.attach(report.finalize(motor_id, num_bytes_read), report.size());
+	send.flush();
+}
+
+int main()
+{
+	usart::init(rs485::baudrate);
+
+	uint8_t* p = report.back();
+	p[0] = report_field::all;
+	for (uint8_t i = 1; i < 11; ++i) p[i] = i;
+	report.publish(11);
+
+	const double built = bench::ns_per_call([]() { respond_built(); tx_done(); });
+	const double pre   = bench::ns_per_call([]() { respond_precomputed(); tx_done(); });
+	const double idle  = bench::ns_per_call([]() { tx_done(); });
+
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+	const char* check = "crc8";
+#else
+	const char* check = "additive";
+#endif
+	printf("request to first tx (host, ns, %s): built %.1f, precomputed %.1f, ratio %.1f\n",
+	       check, built - idle, pre - idle, (built - idle) / (pre - idle));
+	return 0;
+}
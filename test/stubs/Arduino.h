@@ -0,0 +1,72 @@
+#ifndef AVRSIM_ARDUINO_H
+#define AVRSIM_ARDUINO_H
+
+/* Minimal Arduino core on simulated time, see avr/io.h */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A6 20
+#define A7 21
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define _BV(bit) (1 << (bit))
+
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+namespace avrsim {
+	struct pins_t { uint8_t mode[22]; uint8_t level[22]; };
+	inline pins_t& pins(void) { static pins_t p = {{0}, {0}}; return p; }
+}
+
+inline void pinMode     (uint8_t pin, uint8_t mode)  { avrsim::pins().mode[pin]  = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { avrsim::pins().level[pin] = level; }
+inline int  digitalRead (uint8_t pin)                { return avrsim::pins().level[pin]; }
+inline void analogWrite (uint8_t pin, int value)     { avrsim::pins().level[pin] = value > 127; }
+
+/* 32 bit, wrapping like on the AVR */
+inline uint32_t micros(void) { return avrsim::cycles() / 16; }
+inline uint32_t millis(void) { return avrsim::cycles() / 16000; }
+
+/* the firmware only delays on setup and when blinking a failed assert
+   forever, the latter ends the test */
+inline void delay(unsigned long ms) {
+	static unsigned long total = 0;
+	if ((total += ms) > 10000) {
+		fprintf(stderr, "firmware assert, blinking forever\n");
+		exit(2);
+	}
+	avrsim::advance(16000ULL * ms);
+}
+inline void delayMicroseconds(unsigned int us) { avrsim::advance(16ULL * us); }
+
+/* port numbering as in the core: B = 2, C = 3, D = 4 */
+#define digitalPinToPort(p)    ((p) < 8 ? 4 : ((p) < 14 ? 2 : 3))
+#define digitalPinToBitMask(p) (1 << ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+
+inline volatile uint8_t* portOutputRegister(uint8_t port) {
+	return (2 == port) ? &PORTB.value : (3 == port) ? &PORTC.value : &PORTD.value;
+}
+
+#endif /* AVRSIM_ARDUINO_H */
@@ -0,0 +1,104 @@
+#ifndef AVRSIM_VL53L0X_H
+#define AVRSIM_VL53L0X_H
+
+/* Pololu VL53L0X library, the blocking calls through Wire are only
+   logged and take 1 ms of simulated time each. Registers live in a
+   file shared with the bus model of a test, setMeasurementTimingBudget
+   writes the final range timeout as the library does, with fixed
+   overheads of the other steps. */
+
+#include <stdint.h>
+#include <vector>
+#include <avr/io.h>
+
+namespace avrsim {
+	struct vl53l0x_call { const char* name; uint32_t arg; };
+	inline std::vector<vl53l0x_call>& vl53l0x_calls(void) { static std::vector<vl53l0x_call> c; return c; }
+	inline void vl53l0x_log(const char* name, uint32_t arg) {
+		vl53l0x_calls().push_back({name, arg});
+		advance(16000);
+	}
+	inline uint8_t* vl53l0x_regs(void) { static uint8_t r[256]; return r; }
+
+	/* timeout register format of the library (private there) */
+	inline uint16_t vl53l0x_encode(uint32_t mclks) {
+		if (0 == mclks) return 0;
+		uint32_t ls = mclks - 1;
+		uint16_t ms = 0;
+		while (ls & 0xFFFFFF00) { ls >>= 1; ++ms; }
+		return (ms << 8) | (ls & 0xFF);
+	}
+	inline uint32_t vl53l0x_decode(uint16_t v) { return ((uint32_t) (v & 0xFF) << (v >> 8)) + 1; }
+}
+
+class VL53L0X {
+public:
+	enum regAddr {
+		  SYSRANGE_START                       = 0x00
+		, SYSTEM_INTERMEASUREMENT_PERIOD       = 0x04
+		, SYSTEM_INTERRUPT_CLEAR               = 0x0B
+		, RESULT_INTERRUPT_STATUS              = 0x13
+		, RESULT_RANGE_STATUS                  = 0x14
+		, FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI = 0x71
+		, OSC_CALIBRATE_VAL                    = 0xF8
+	};
+
+	enum vcselPeriodType { VcselPeriodPreRange, VcselPeriodFinalRange };
+
+	/* of the model, used by setMeasurementTimingBudget */
+	static const uint8_t  stop_variable     = 0x3C;
+	static const uint16_t osc_calibrate_val = 1073;
+	static const uint8_t  final_vcsel       = 10;    /* PCLKs */
+	static const uint32_t used_budget_us    = 5490;  /* start, end, tcc, dss, pre range, final range */
+	static const uint16_t pre_range_mclks   = 94;
+
+	bool init(bool = true) {
+		uint8_t* r = avrsim::vl53l0x_regs();
+		r[0x91] = stop_variable;
+		r[OSC_CALIBRATE_VAL]     = osc_calibrate_val >> 8;
+		r[OSC_CALIBRATE_VAL + 1] = osc_calibrate_val & 0xff;
+		avrsim::vl53l0x_log("init", 0);
+		return true;
+	}
+	void     setTimeout(uint16_t t)                  { timeout = t; }
+	uint8_t  getAddress(void)                        { return 0x29; }
+	void     startContinuous(uint32_t period_ms = 0) {
+		avrsim::vl53l0x_regs()[SYSRANGE_START] = period_ms ? 0x04 : 0x02;
+		avrsim::vl53l0x_log("startContinuous", period_ms);
+	}
+	void     stopContinuous(void) {
+		avrsim::vl53l0x_regs()[SYSRANGE_START] = 0x01;
+		avrsim::vl53l0x_log("stopContinuous", 0);
+	}
+	bool     setMeasurementTimingBudget(uint32_t us) {
+		const uint32_t macro_ns = ((2304UL * final_vcsel * 1655) + 500) / 1000;
+		const uint32_t final_us = us - used_budget_us;
+		const uint32_t mclks    = (final_us * 1000 + macro_ns / 2) / macro_ns + pre_range_mclks;
+		const uint16_t v        = avrsim::vl53l0x_encode(mclks);
+		avrsim::vl53l0x_regs()[FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI]     = v >> 8;
+		avrsim::vl53l0x_regs()[FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI + 1] = v & 0xff;
+		avrsim::vl53l0x_log("setMeasurementTimingBudget", us);
+		return true;
+	}
+	uint8_t  getVcselPulsePeriod(vcselPeriodType t) {
+		avrsim::vl53l0x_log("getVcselPulsePeriod", t);
+		return (VcselPeriodFinalRange == t) ? final_vcsel : 14;
+	}
+
+	void     writeReg(uint8_t reg, uint8_t value) {
+		avrsim::vl53l0x_regs()[reg] = value;
+		avrsim::vl53l0x_log("writeReg", reg);
+	}
+	uint8_t  readReg(uint8_t reg) {
+		avrsim::vl53l0x_log("readReg", reg);
+		return avrsim::vl53l0x_regs()[reg];
+	}
+	uint16_t readReg16Bit(uint8_t reg) {
+		avrsim::vl53l0x_log("readReg16Bit", reg);
+		return (avrsim::vl53l0x_regs()[reg] << 8) | avrsim::vl53l0x_regs()[(uint8_t) (reg + 1)];
+	}
+
+	uint16_t timeout = 0;
+};
+
+#endif /* AVRSIM_VL53L0X_H */
@@ -0,0 +1,40 @@
+#ifndef AVRSIM_EEPROM_H
+#define AVRSIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* 1 KiB of erased EEPROM, write cycles are counted per cell */
+namespace avrsim {
+	struct eeprom_t {
+		uint8_t  cell[1024];
+		uint32_t writes[1024];
+		eeprom_t() { memset(cell, 0xFF, sizeof(cell)); memset(writes, 0, sizeof(writes)); }
+	};
+	inline eeprom_t& eeprom(void) { static eeprom_t e; return e; }
+	inline uintptr_t eeaddr(const volatile void* p) { return (uintptr_t) p & 1023; }
+}
+
+inline bool     eeprom_is_ready(void)  { return true; }
+inline void     eeprom_busy_wait(void) {}
+inline uint8_t  eeprom_read_byte(const uint8_t* p)  { return avrsim::eeprom().cell[avrsim::eeaddr(p)]; }
+inline uint16_t eeprom_read_word(const uint16_t* p) {
+	const uintptr_t a = avrsim::eeaddr(p);
+	return avrsim::eeprom().cell[a] | (avrsim::eeprom().cell[a + 1] << 8);
+}
+inline void eeprom_read_block(void* dst, const void* src, size_t n) {
+	for (size_t i = 0; i < n; ++i)
+		((uint8_t*) dst)[i] = avrsim::eeprom().cell[avrsim::eeaddr(src) + i];
+}
+inline void eeprom_write_byte(uint8_t* p, uint8_t v) {
+	const uintptr_t a = avrsim::eeaddr(p);
+	avrsim::eeprom().cell[a] = v;
+	++avrsim::eeprom().writes[a];
+}
+inline void eeprom_update_byte(uint8_t* p, uint8_t v) { if (eeprom_read_byte(p) != v) eeprom_write_byte(p, v); }
+inline void eeprom_update_word(uint16_t* p, uint16_t v) {
+	eeprom_update_byte((uint8_t*) p, v & 0xff);
+	eeprom_update_byte((uint8_t*) p + 1, v >> 8);
+}
+
+#endif /* AVRSIM_EEPROM_H */
@@ -0,0 +1,12 @@
+#ifndef AVRSIM_INTERRUPT_H
+#define AVRSIM_INTERRUPT_H
+
+#include <avr/io.h>
+
+/* ISRs become plain functions, tests call them to raise the interrupt */
+#define ISR(vector) void vector(void)
+
+#define cli() (SREG.value &= 0x7F)
+#define sei() (SREG.value |= 0x80)
+
+#endif /* AVRSIM_INTERRUPT_H */
@@ -0,0 +1,104 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef AVRSIM_IO_H
+#define AVRSIM_IO_H
+
+#include <stdint.h>
+#include <functional>
+
+/*
+	Host stand-in for the ATmega328P registers used by the firmware.
+
+	A register is plain storage unless a test hooks its reads or writes
+	to model the hardware behind it, e.g. a timer counting simulated
+	time or a TWI peripheral with a device on the bus. Simulated time is
+	kept in cpu cycles (16 MHz), tests advance it explicitly.
+
+	Each test is a single translation unit, so everything is static.
+*/
+
+namespace avrsim {
+
+	inline uint64_t& cycles(void) { static uint64_t c = 0; return c; }
+
+	inline void advance(uint64_t n) { cycles() += n; }
+
+	template <typename T>
+	struct reg {
+		volatile T value = 0;
+		std::function<void(reg&)>    on_read;
+		std::function<void(reg&, T)> on_write;
+
+		operator T() { if (on_read) on_read(*this); return value; }
+		/* any integer, truncated like the hardware does */
+		template <typename U> reg& operator= (U v) { const T t = v; if (on_write) on_write(*this, t); else value = t; return *this; }
+		template <typename U> reg& operator|=(U v) { return *this = T(*this) | v; }
+		template <typename U> reg& operator&=(U v) { return *this = T(*this) & v; }
+		template <typename U> reg& operator^=(U v) { return *this = T(*this) ^ v; }
+	};
+
+	typedef reg<uint8_t>  reg8;
+	typedef reg<uint16_t> reg16;
+
+} /* namespace avrsim */
+
+#define AVRSIM_REG8(n)  static avrsim::reg8  n;
+#define AVRSIM_REG16(n) static avrsim::reg16 n;
+
+AVRSIM_REG8(SREG)
+AVRSIM_REG8(PORTB) AVRSIM_REG8(PORTC) AVRSIM_REG8(PORTD)
+AVRSIM_REG8(DDRB)  AVRSIM_REG8(DDRC)  AVRSIM_REG8(DDRD)
+AVRSIM_REG8(PINB)  AVRSIM_REG8(PINC)  AVRSIM_REG8(PIND)
+AVRSIM_REG8(UCSR0A) AVRSIM_REG8(UCSR0B) AVRSIM_REG8(UCSR0C) AVRSIM_REG16(UBRR0) AVRSIM_REG8(UDR0)
+AVRSIM_REG8(ADMUX) AVRSIM_REG8(ADCSRA) AVRSIM_REG8(ADCSRB) AVRSIM_REG16(ADC) AVRSIM_REG8(DIDR0)
+AVRSIM_REG8(TCCR1A) AVRSIM_REG8(TCCR1B) AVRSIM_REG16(TCNT1) AVRSIM_REG16(ICR1) AVRSIM_REG8(TIMSK1) AVRSIM_REG8(TIFR1)
+AVRSIM_REG8(TCCR2A) AVRSIM_REG8(TCCR2B) AVRSIM_REG8(TCNT2) AVRSIM_REG8(OCR2A) AVRSIM_REG8(OCR2B) AVRSIM_REG8(TIMSK2) AVRSIM_REG8(TIFR2)
+AVRSIM_REG8(PCICR) AVRSIM_REG8(PCIFR) AVRSIM_REG8(PCMSK0)
+AVRSIM_REG8(TWCR) AVRSIM_REG8(TWSR) AVRSIM_REG8(TWDR) AVRSIM_REG8(TWBR)
+
+enum {
+	/* usart */
+	  MPCM0 = 0, U2X0 = 1, UPE0 = 2, DOR0 = 3, FE0 = 4, UDRE0 = 5, TXC0 = 6, RXC0 = 7
+	, TXB80 = 0, RXB80 = 1, UCSZ02 = 2, TXEN0 = 3, RXEN0 = 4, UDRIE0 = 5, TXCIE0 = 6, RXCIE0 = 7
+	, UCSZ00 = 1, UCSZ01 = 2
+	/* adc */
+	, MUX0 = 0, MUX1 = 1, MUX2 = 2, MUX3 = 3, ADLAR = 5, REFS0 = 6, REFS1 = 7
+	, ADPS0 = 0, ADPS1 = 1, ADPS2 = 2, ADIE = 3, ADIF = 4, ADATE = 5, ADSC = 6, ADEN = 7
+	/* timers */
+	, WGM10 = 0, WGM11 = 1, WGM12 = 3, WGM13 = 4, CS10 = 0, CS11 = 1, CS12 = 2
+	, WGM20 = 0, WGM21 = 1, CS20 = 0, CS21 = 1, CS22 = 2
+	, TOIE2 = 0, OCIE2A = 1, OCIE2B = 2, TOV2 = 0, OCF2A = 1, OCF2B = 2
+	/* pin change */
+	, PCIE0 = 0, PCIF0 = 0, PCINT0 = 0
+	/* ports */
+	, PB0 = 0, PB4 = 4, PB5 = 5, PC4 = 4, PC5 = 5, PD2 = 2, PD7 = 7
+	/* twi */
+	, TWIE = 0, TWEN = 2, TWWC = 3, TWSTO = 4, TWSTA = 5, TWEA = 6, TWINT = 7
+	, TWPS0 = 0, TWPS1 = 1
+};
+
+namespace avrsim {
+
+	/* timer 1 and 2 count with prescaler 8, as configured by the firmware */
+	struct timers {
+		timers() {
+			TCNT1.on_read = [](reg16& r) {
+				const uint32_t top = ICR1.value ? ICR1.value + 1UL : 0x10000UL;
+				r.value = (cycles() / 8) % top;
+			};
+			TCNT2.on_read = [](reg8& r) { r.value = cycles() / 8; };
+		}
+	};
+	static timers timers_running;
+
+} /* namespace avrsim */
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#endif /* AVRSIM_IO_H */
@@ -0,0 +1,3 @@
+#ifndef AVRSIM_DELAY_H
+#define AVRSIM_DELAY_H
+#endif
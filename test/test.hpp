@@ -0,0 +1,33 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+#ifndef JETPACK_TEST_HPP
+#define JETPACK_TEST_HPP
+
+#include <stdio.h>
+
+/* Minimal checks for the host tests, a test returns test::result() */
+
+namespace test {
+
+	inline unsigned& failures(void) { static unsigned n = 0; return n; }
+
+	inline int result(const char* name) {
+		printf("%s: %s\n", name, failures() ? "FAILED" : "passed");
+		return failures() ? 1 : 0;
+	}
+
+} /* namespace test */
+
+#define CHECK(cond)                                                         \
+	do {                                                                    \
+		if (!(cond)) {                                                      \
+			++test::failures();                                             \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		}                                                                   \
+	} while (0)
+
+#endif /* JETPACK_TEST_HPP */
@@ -0,0 +1,148 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Interrupt driven capacitive sensing (capsense engine).
+
+	The RC of a receive pin is mocked by setting its level in PINB after
+	the charge and discharge times and calling the pin change ISR, with
+	the timer 1 count following simulated time. Checks the pin setup per
+	phase, the measured time, the alternation of the channels, the
+	timeout, a result coming in just when the timeout hits, spurious pin
+	changes and a measurement across the wrap of timer 1.
+*/
+
+#include "test.hpp"
+#include "jcl_capsense.hpp"
+
+using namespace jetpack;
+
+const uint8_t send_pin = 4, recv_pin[2] = {8, 9};
+const uint8_t recv_mask[2] = {1<<PB0, 1<<1};
+
+void advance_us(double us) { avrsim::advance((uint64_t) (us * 16)); }
+
+void edge(uint8_t m, bool level)
+{
+	PINB.value = level ? (PINB.value | m) : (PINB.value & ~m);
+	PCINT0_vect();
+}
+
+/* charge and discharge of the running channel, times in us */
+void measure(uint8_t ch, double t_charge, double t_discharge)
+{
+	const uint8_t m = recv_mask[ch];
+	CHECK(capsense::charging == capsense::state);
+	CHECK(m == PCMSK0.value and (PCICR.value & (1<<PCIE0)));
+	CHECK(0 == (DDRB.value & m));               /* receive pin is input */
+	CHECK(PORTD.value & (1<<send_pin));         /* send pin charges */
+
+	advance_us(t_charge);
+	edge(m, true);
+	CHECK(capsense::discharging == capsense::state);
+	CHECK(0 == (PORTD.value & (1<<send_pin)));  /* discharges through send pin */
+
+	advance_us(t_discharge);
+	edge(m, false);
+	CHECK(capsense::idle == capsense::state);
+	CHECK(capsense::ready);
+	CHECK(0 == PCMSK0.value);
+	CHECK(DDRB.value & m);                      /* held low again */
+}
+
+int main()
+{
+	clock::init();
+	CapSense cs0(send_pin, recv_pin[0]);
+	CapSense cs1(send_pin, recv_pin[1]);
+	CHECK(2 == capsense::num_registered);
+
+	/* first step starts channel 0 */
+	capsense::step();
+	CHECK(capsense::running and 0 == capsense::active);
+	measure(0, 150, 120);
+	CHECK(not capsense::fresh[0]);
+
+	/* collected on the next step, which starts channel 1 */
+	capsense::step();
+	CHECK(capsense::fresh[0]);
+	CHECK(540 == capsense::value[0]);           /* 270 us in 0.5 us ticks */
+	CHECK(1 == capsense::active);
+
+	/* a pin change of the other channel is ignored */
+	advance_us(50);
+	edge(recv_mask[0], true);
+	CHECK(capsense::charging == capsense::state);
+	PINB.value = 0;
+	measure(1, 150, 180);            /* charging since 50 us */
+	capsense::step();
+	CHECK(760 == capsense::value[1]);
+	CHECK(0 == capsense::active);
+
+	/* while measuring, step does nothing */
+	advance_us(500);
+	capsense::step();
+	CHECK(0 == capsense::active and capsense::charging == capsense::state);
+
+	/* no edge within 1 ms: aborted, last value kept, next channel */
+	capsense::fresh[0] = false;
+	advance_us(600);
+	capsense::step();
+	CHECK(not capsense::fresh[0] and 540 == capsense::value[0]);
+	CHECK(1 == capsense::active and capsense::charging == capsense::state);
+	CHECK(DDRB.value & recv_mask[0]);           /* aborted pin held low */
+
+	/* result comes in between the ready check and the timeout: the
+	   next channel must not take it for its own */
+	{
+		capsense::abort();
+		capsense::start(0);
+		advance_us(900);
+		edge(recv_mask[0], true);               /* discharging */
+		advance_us(150);
+
+		auto timer = TCNT1.on_read;
+		bool fired = false;
+		TCNT1.on_read = [&](avrsim::reg16& r) {
+			timer(r);
+			if (fired) return;
+			fired = true;                       /* first read is the timeout check */
+			edge(recv_mask[0], false);
+		};
+		capsense::step();
+		TCNT1.on_read = timer;
+
+		CHECK(fired);
+		CHECK(1 == capsense::active and capsense::charging == capsense::state);
+		CHECK(not capsense::ready);
+		capsense::fresh[1] = false;
+		capsense::step();                       /* nothing to collect yet */
+		CHECK(1 == capsense::active and not capsense::fresh[1]);
+		measure(1, 100, 100);
+		capsense::step();
+		CHECK(capsense::fresh[1] and 400 == capsense::value[1]);
+	}
+
+	/* measurement across the wrap of timer 1 (20 ms) */
+	{
+		const uint64_t period = 8ULL * (clock::top + 1);
+		avrsim::cycles() = (avrsim::cycles() / period + 1) * period - 16 * 100; /* 100 us before */
+		capsense::abort();
+		capsense::start(1);
+		measure(1, 150, 150);
+		capsense::step();
+		CHECK(600 == capsense::value[1]);
+	}
+
+	/* the neurons take the fresh values */
+	CHECK(capsense::fresh[1]);
+	cs1.step();
+	CHECK(not capsense::fresh[1]);
+	CHECK((600UL << 8) == cs1.x);
+	(void) cs0;
+
+	return test::result("capsense");
+}
@@ -0,0 +1,99 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Frame check, built once per selection (JETPACK_CHECKSUM=1 for CRC-8).
+
+	A frame with its trailer appended must check valid, and the CRC must
+	be CRC-8/MAXIM: the table against the bitwise definition and the
+	standard check value. The CRC must also catch every burst error of up
+	to 8 bits, which the sum does not (e.g. +1 in one byte, -1 in the next).
+*/
+
+#include <random>
+#include "test.hpp"
+#include "checksum.hpp"
+
+using namespace jetpack;
+
+std::mt19937 rng(5);
+
+/* CRC-8/MAXIM, bit by bit: poly 0x31 reflected, init 0, no final xor */
+uint8_t crc8_bitwise(const uint8_t* p, unsigned len)
+{
+	uint8_t crc = 0;
+	for (unsigned i = 0; i < len; ++i) {
+		crc ^= p[i];
+		for (uint8_t b = 0; b < 8; ++b)
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+	}
+	return crc;
+}
+
+uint8_t compute(const uint8_t* p, unsigned len)
+{
+	checksum chk;
+	for (unsigned i = 0; i < len; ++i) chk.add(p[i]);
+	return chk.trailer();
+}
+
+bool check(const uint8_t* p, unsigned len)
+{
+	checksum chk;
+	for (unsigned i = 0; i < len; ++i) chk.add(p[i]);
+	return chk.valid();
+}
+
+void test_trailer(void)
+{
+	uint8_t f[65];
+	for (unsigned run = 0; run < 10000; ++run) {
+		const unsigned len = 1 + rng() % 64;
+		for (unsigned i = 0; i < len; ++i) f[i] = rng();
+		f[len] = compute(f, len);
+		CHECK(check(f, len + 1));
+		f[rng() % (len + 1)] ^= 1 << (rng() % 8); /* any single bit error */
+		CHECK(not check(f, len + 1));
+	}
+}
+
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+void test_crc8(void)
+{
+	const uint8_t check_value[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+	CHECK(0xA1 == compute(check_value, 9));
+
+	for (unsigned i = 0; i < 256; ++i) {
+		const uint8_t b = i;
+		CHECK(pgm_read_byte(&crc8_table[i]) == crc8_bitwise(&b, 1));
+	}
+
+	uint8_t f[33];
+	for (unsigned run = 0; run < 1000; ++run) {
+		for (unsigned i = 0; i < 32; ++i) f[i] = rng();
+		CHECK(crc8_bitwise(f, 32) == compute(f, 32));
+
+		/* burst of up to 8 bits, may span two bytes */
+		f[32] = compute(f, 32);
+		const unsigned len = 1 + rng() % 8, start = rng() % (33 * 8 - len);
+		const uint8_t burst = (len > 1) ? (1 | 1 << (len - 1) | (rng() & ((1 << len) - 1))) : 1;
+		for (unsigned b = 0; b < len; ++b)
+			if (burst & (1 << b)) f[(start + b) / 8] ^= 1 << ((start + b) % 8);
+		CHECK(not check(f, 33));
+	}
+}
+#endif
+
+int main()
+{
+	test_trailer();
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+	test_crc8();
+	return test::result("checksum (crc8)");
+#else
+	return test::result("checksum");
+#endif
+}
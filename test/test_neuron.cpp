@@ -0,0 +1,104 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Fixed-point capacitive sensor neuron against the float version it
+	replaced, fed with identical raw sequences.
+
+	They cannot match exactly: x is kept in Q.8 and multiplied by w with
+	its fraction truncated, w keeps 16 bits in the product, eta_w is
+	2^-21 instead of 5e-7 and tanh is interpolated from a table. The
+	outputs must stay within a small tolerance and the adaptation of w
+	must follow the float version: max. 0.05 and mean 0.01 apart (y is in
+	-1..1), w within 1 % after 10 minutes.
+
+	The run time of the two is not compared here. The float version is
+	slow on the AVR because of the soft-float library, while the host has
+	an FPU, so a host timing would say nothing about the AVR.
+*/
+
+#include <math.h>
+#include <random>
+#include "test.hpp"
+#include "jcl_capsense.hpp"
+
+using namespace jetpack;
+
+/* float version, as before the fixed-point port, reading from a sequence */
+struct float_neuron {
+	float w = 0.01f, x, y = 0, b;
+	const float eta = 0.005f, eta_w = .0000005, lp = 0.1f;
+
+	float_neuron(float raw) : x(raw), b(-w*raw) {}
+
+	float step(float raw) {
+		x = lp*raw + (1-lp)*x;
+		y = tanh(w*x + b);
+		b += (b > -w*x) ? -eta*y : -10*eta*y;
+		if (fabs(y) > .6f) w *= 1-eta_w;
+		if (fabs(y) < .4f) w *= 1+eta_w;
+		return y;
+	}
+};
+
+std::mt19937 rng(3);
+
+struct result_t { double max_err, mean_err, w_ratio; };
+
+/* raw(k) gives the measurement of step k */
+template <typename F>
+result_t compare(CapSense& fixed, F raw, unsigned num_steps)
+{
+	const uint16_t r0 = raw(0);
+	float_neuron ref(r0);
+	double max_err = 0, sum_err = 0;
+
+	for (unsigned k = 0; k < num_steps; ++k) {
+		const uint16_t r = raw(k);
+		capsense::value[0] = r;
+		capsense::fresh[0] = true;
+		const double yf = fixed.step() / 32768.0;
+		const double yr = ref.step(r);
+		const double e  = fabs(yf - yr);
+		if (e > max_err) max_err = e;
+		sum_err += e;
+	}
+	return {max_err, sum_err / num_steps, (fixed.w / 4294967296.0) / ref.w};
+}
+
+int main()
+{
+	CapSense proto(4, 8);
+	std::normal_distribution<double> noise(0, 3);
+
+	/* 100 Hz per channel, 10 minutes, untouched: noise around a constant */
+	CapSense n1 = proto;
+	const result_t quiet = compare(n1, [&](unsigned) { return (uint16_t) (600 + noise(rng)); }, 60000);
+
+	/* touches of 2 s every 10 s, with drift of the baseline */
+	CapSense n2 = proto;
+	const result_t touch = compare(n2, [&](unsigned k) {
+		const double base = 600 + 50 * sin(k * 1e-4);
+		return (uint16_t) (base + ((k % 1000) < 200 ? 300 : 0) + noise(rng));
+	}, 60000);
+
+	/* ramp over the whole range the engine can report */
+	CapSense n3 = proto;
+	const result_t ramp = compare(n3, [&](unsigned k) { return (uint16_t) (100 + k / 30); }, 60000);
+
+	for (const result_t& r : {quiet, touch, ramp}) {
+		CHECK(r.max_err  < 0.05);
+		CHECK(r.mean_err < 0.01);
+		CHECK(fabs(r.w_ratio - 1) < 0.01);
+	}
+
+	printf("neuron |y fixed - y float|: quiet max %.4f mean %.5f, touch max %.4f mean %.5f, ramp max %.4f mean %.5f\n",
+	       quiet.max_err, quiet.mean_err, touch.max_err, touch.mean_err, ramp.max_err, ramp.mean_err);
+	printf("neuron w fixed / w float after 60000 steps: %.4f %.4f %.4f\n",
+	       quiet.w_ratio, touch.w_ratio, ramp.w_ratio);
+
+	return test::result("neuron");
+}
@@ -0,0 +1,97 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Precomputed data_response frame (data_report).
+
+	The frame patched on a request must be identical to one built byte
+	by byte, for both checksums (built again with JETPACK_CHECKSUM=1).
+	Publishing must never touch the frame being sent.
+*/
+
+#include <random>
+#include "test.hpp"
+#include "report.hpp"
+
+using namespace jetpack;
+
+std::mt19937 rng(7);
+
+void test_finalize(void)
+{
+	data_report report;
+	for (unsigned run = 0; run < 1000; ++run) {
+		const uint8_t n = rng() % (data_report::max_payload + 1);
+		uint8_t* p = report.back();
+		CHECK(nullptr != p);
+		uint8_t payload[data_report::max_payload];
+		for (uint8_t i = 0; i < n; ++i) p[i] = payload[i] = rng();
+		report.publish(n);
+
+		const uint8_t id = rng() & 0x7F, num_read = rng();
+		const uint8_t* f = report.finalize(id, num_read);
+		CHECK(data_report::num_header + n + 1 == report.size());
+
+		/* reference, built byte by byte */
+		checksum chk;
+		const uint8_t header[6] = {0xFF, 0xFF, 0xC1, id, (uint8_t) (n + 1), num_read};
+		bool same = true;
+		for (uint8_t i = 0; i < 6; ++i) { chk.add(header[i]); same &= (header[i] == f[i]); }
+		for (uint8_t i = 0; i < n; ++i) { chk.add(payload[i]); same &= (payload[i] == f[6 + i]); }
+		CHECK(same);
+		CHECK(chk.trailer() == f[report.size() - 1]);
+	}
+}
+
+void test_double_buffer(void)
+{
+	data_report report;
+	uint8_t* p = report.back();
+	p[0] = 0x11;
+	report.publish(1);
+	const uint8_t* f = report.finalize(3, 0);
+	usart::write(f, report.size());   /* on the wire now */
+
+	p = report.back();                /* the other buffer is free */
+	CHECK(nullptr != p);
+	p[0] = 0x22;
+	report.publish(1);
+	CHECK(nullptr == report.back());  /* previous front is still sent */
+	CHECK(0x11 == f[6]);              /* and untouched */
+
+	usart::tx_finished();
+	CHECK(nullptr != report.back());
+}
+
+void test_pack10(void)
+{
+	const uint16_t v[5] = {0x3FF, 0x000, 0x155, 0x2AA, 0x001};
+	uint8_t out[8] = {0};
+	CHECK(7 == pack10(out, v, 5)); /* 50 bits */
+
+	/* reference, bit by bit */
+	uint8_t ref[8] = {0};
+	unsigned bit = 0;
+	for (uint8_t i = 0; i < 5; ++i)
+		for (int b = 9; b >= 0; --b, ++bit)
+			if (v[i] & (1 << b)) ref[bit / 8] |= 0x80 >> (bit % 8);
+	bool same = true;
+	for (uint8_t i = 0; i < 7; ++i) same &= (ref[i] == out[i]);
+	CHECK(same);
+}
+
+int main()
+{
+	usart::init(rs485::baudrate);
+	test_finalize();
+	test_double_buffer();
+	test_pack10();
+#if JETPACK_CHECKSUM == JETPACK_CHECKSUM_CRC8
+	return test::result("report (crc8)");
+#else
+	return test::result("report");
+#endif
+}
@@ -0,0 +1,65 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Task scheduler (scheduler.hpp) on the timer 1 clock.
+
+	Tasks advance simulated time by their run time. Over a second, i.e.
+	50 wraps of the clock, the tasks must run at their periods, the
+	longest run times and budget overruns must match what the tasks did,
+	and a released task must run on the next step.
+*/
+
+#include "test.hpp"
+#include "scheduler.hpp"
+
+using namespace jetpack;
+
+const uint64_t us = 16; /* cycles */
+
+unsigned runs_fast = 0, runs_slow = 0, runs_long = 0, polls = 0;
+
+void poll(void) { ++polls; avrsim::advance(10 * us); }
+
+void task_fast(void) { ++runs_fast; avrsim::advance(50 * us); }
+
+/* every 10th run takes longer than its budget */
+void task_slow(void)
+{
+	if (0 == ++runs_slow % 10) { ++runs_long; avrsim::advance(300 * us); }
+	else avrsim::advance(150 * us);
+}
+
+task tasks[2] = {
+	/* function   period us  budget us  priority */
+	{ task_fast,     1000,      100,       1 },
+	{ task_slow,     5000,      200,       0 },
+};
+
+int main()
+{
+	clock::init();
+	scheduler<2> sched(tasks, poll);
+	sched.init();
+
+	const uint64_t end = avrsim::cycles() + 1000000 * us;
+	while (avrsim::cycles() < end) sched.step();
+
+	CHECK(runs_fast >= 995 and runs_fast <= 1001);
+	CHECK(runs_slow >= 199 and runs_slow <= 201);
+	CHECK(50 == tasks[0].max_us and 0 == tasks[0].overruns);
+	CHECK(300 == tasks[1].max_us and runs_long == tasks[1].overruns);
+
+	/* released, runs on the next step regardless of its period */
+	sched.step();
+	const unsigned slow = runs_slow;
+	sched.release(1);
+	sched.step();
+	CHECK(slow + 1 == runs_slow);
+	CHECK(not sched.get(1).released);
+
+	return test::result("scheduler");
+}
@@ -0,0 +1,116 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Generated ADC channel schedules (sequencer.hpp) and the ADC ISR
+	walking the schedule.
+
+	A schedule must contain every channel exactly weight times, spread
+	over the whole schedule rather than in a block. The ISR is run on a
+	mocked ADC that converts channel c to a fixed value, so the order of
+	the channels, the sample counts and the decimated results can be
+	compared with the schedule.
+*/
+
+#include <vector>
+#include "test.hpp"
+#include "adc.hpp"
+
+using namespace supreme;
+
+template <typename S>
+std::vector<uint8_t> entries(void)
+{
+	std::vector<uint8_t> e;
+	for (uint8_t i = 0; i < S::length; ++i)
+		e.push_back(pgm_read_byte(&S::table()[i]));
+	return e;
+}
+
+/* channel c appears w times, never more than 2 length/w apart (cyclic) */
+template <typename S>
+void check_spread(uint8_t c, uint8_t w)
+{
+	const std::vector<uint8_t> e = entries<S>();
+	std::vector<unsigned> pos;
+	for (unsigned i = 0; i < e.size(); ++i)
+		if (c == e[i]) pos.push_back(i);
+	CHECK(w == pos.size());
+	for (unsigned k = 0; k < pos.size(); ++k) {
+		const unsigned next = (k + 1 < pos.size()) ? pos[k + 1] : pos[0] + e.size();
+		CHECK(next - pos[k] <= 2 * e.size() / w);
+	}
+}
+
+void test_schedules(void)
+{
+	/* example of sequencer.hpp */
+	typedef sequencer< channel<0,4>, channel<1,4>, channel<2,4>, channel<3,4>, channel<6,1>, channel<7,1> > potis;
+	const std::vector<uint8_t> expected = {0,1,2,3, 0,1,2,3, 0,1,2,3, 0,1,2,3,6,7};
+	CHECK(expected == entries<potis>());
+
+	/* uneven weights */
+	typedef sequencer< channel<5,3>, channel<2,2>, channel<4,1> > uneven;
+	const std::vector<uint8_t> expected_uneven = {5, 5,2, 5,2,4};
+	CHECK(expected_uneven == entries<uneven>());
+	check_spread<uneven>(5, 3);
+	check_spread<uneven>(2, 2);
+	check_spread<uneven>(4, 1);
+
+	/* weights without a common divisor */
+	typedef sequencer< channel<0,7>, channel<1,5>, channel<2,3>, channel<3,2>, channel<4,1> > odd;
+	CHECK(18 == odd::length);
+	CHECK(7 == odd::rounds);
+	check_spread<odd>(0, 7);
+	check_spread<odd>(1, 5);
+	check_spread<odd>(2, 3);
+	check_spread<odd>(3, 2);
+	check_spread<odd>(4, 1);
+
+	/* single channel */
+	typedef sequencer< channel<3,1> > single;
+	CHECK(1 == single::length and 3 == pgm_read_byte(&single::table()[0]));
+}
+
+void test_adc_isr(void)
+{
+	ADC.on_read = [](avrsim::reg16& r) { r.value = 100 + 10 * (ADMUX.value & 0x07); };
+	adc::init();
+	CHECK(ADMUX.value == (adc::vref | adc::poti_0));
+	CHECK(((1<<ADPS2) | (1<<ADPS1)) == (ADCSRA.value & 0x07)); /* 250 kHz */
+	CHECK(52 == adc::conversion_us);
+	CHECK(3744 == adc::update_period_us(adc::poti_0));
+	CHECK(14976 == adc::update_period_us(adc::brgt_1));
+
+	const std::vector<uint8_t> sched = entries<adc::schedule>();
+	unsigned conversions[8] = {0}, order_errors = 0;
+	const unsigned num_rounds = adc::oversampling; /* every channel completes */
+
+	for (unsigned i = 0; i < num_rounds * sched.size(); ++i) {
+		const uint8_t ch = ADMUX.value & 0x07;
+		if (ch != sched[i % sched.size()]) ++order_errors;
+		++conversions[ch];
+		ADC_vect();
+	}
+	CHECK(0 == order_errors);
+	CHECK(4 == conversions[adc::poti_0] / conversions[adc::brgt_0]);
+	CHECK(conversions[adc::poti_0] == conversions[adc::poti_3]);
+	CHECK(conversions[adc::brgt_0] == conversions[adc::brgt_1]);
+	CHECK(0 == conversions[4] + conversions[5]);
+
+	/* 16 samples of v decimated to 12 bit: 4 v */
+	adc::snapshot s;
+	adc::get_snapshot(s);
+	for (uint8_t c : {adc::poti_0, adc::poti_1, adc::poti_2, adc::poti_3, adc::brgt_0, adc::brgt_1})
+		CHECK(s.value[c] == 4 * (100 + 10 * c));
+}
+
+int main()
+{
+	test_schedules();
+	test_adc_isr();
+	return test::result("sequencer");
+}
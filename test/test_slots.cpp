@@ -0,0 +1,355 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Timing simulation of the collective readout (data_collect).
+
+	Every node runs the real firmware path: the request's bytes enter
+	through the RX ISR at their arrival times, the parser runs when the
+	node gets to poll (random delay, as after any task), arms the slot
+	timer and timer 2's compare ISR starts the transmission. Per node the
+	clock has a random phase and drift, each ISR a random latency. The
+	nodes are simulated one after the other, their transmissions are then
+	put on one time axis (0 is the end of the request) and checked for
+	overlap, including the time until the previous sender has released
+	the bus in its TX complete ISR. Runs with the default lead and with a
+	short one passed by the host, which small groups need to keep the
+	bus utilized. Also checks the diag_response with the task statistics,
+	which the other nodes must skip.
+*/
+
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "test.hpp"
+#include "communication.hpp"
+
+using namespace jetpack;
+
+/* what the communication needs from the core */
+struct mock_core {
+	enum { num_histograms = 2 };
+
+	data_report   report;
+	log_histogram hist;
+
+	mock_core() {
+		uint8_t* p = report.back();
+		p[0] = report_field::all;
+		for (uint8_t i = 1; i < 11; ++i) p[i] = 0x10 + i;
+		report.publish(11);
+	}
+
+	void         disable(void) {}
+	void         enable(void) {}
+	void         set_target_pwm(const uint8_t*) {}
+	void         set_report_mask(uint16_t) {}
+	bool         set_range_profile(uint8_t, uint8_t) { return true; }
+	uint8_t      get_range_budget(void) const { return 33; }
+	uint8_t      get_range_period(void) const { return 0; }
+	bool         set_pixels(const uint8_t*, uint8_t) { return true; }
+	void         save_calibration(void) {}
+	data_report& get_report(void) { return report; }
+	log_histogram& get_histogram(uint8_t) { return hist; }
+};
+
+typedef communication_ctrl<mock_core> com_t;
+
+const uint8_t frame_size = 6 + 11 + 1; /* data_response of the mock */
+
+struct setup_t {
+	double   max_parse_us;    /* latency until the node polls */
+	double   max_isr_us;      /* interrupt latency */
+	double   max_drift;       /* clock tolerance */
+	uint8_t  slot_len;
+	uint8_t  lead;            /* in 10 us, 0 for the default */
+};
+
+struct tx_t {
+	uint8_t id;
+	bool    sent;
+	double  start, end;       /* first start bit, bus released */
+	uint8_t len;
+	bool    valid;            /* transmitted frame is a data_response of id */
+};
+
+std::mt19937 rng(42);
+
+double uniform(double a, double b) { return std::uniform_real_distribution<double>(a, b)(rng); }
+
+/* node local time */
+struct node_clock {
+	uint64_t base;            /* cycles at global time 0, large enough that
+	                             cycles stay positive from -2000 us on */
+	double   rate;            /* 1 + drift */
+
+	void   set(double t_us) { avrsim::cycles() = base + (int64_t) (t_us * rate * 16.0); }
+	double global(void) const { return ((double) avrsim::cycles() - (double) base) / (16.0 * rate); }
+};
+
+void receive(uint8_t byte, bool addr)
+{
+#if JETPACK_RS485_MPCM
+	if ((UCSR0A.value & (1<<MPCM0)) and not addr) return;
+#else
+	(void) addr;
+#endif
+	UCSR0B.value = addr ? (UCSR0B.value | (1<<RXB80)) : (UCSR0B.value & ~(1<<RXB80));
+	UDR0.value = byte;
+	USART_RX_vect();
+}
+
+/* bytes of a frame with checksum */
+std::vector<uint8_t> frame(uint8_t cmd, uint8_t id, const std::vector<uint8_t>& payload)
+{
+	std::vector<uint8_t> f(payload);
+	const uint8_t header[4] = {0xFF, 0xFF, cmd, id};
+	f.insert(f.begin(), header, header + 4);
+	checksum chk;
+	for (uint8_t b : f) chk.add(b);
+	f.push_back(chk.trailer());
+	return f;
+}
+
+/* host sends the frame, its last byte ends at t_end */
+void send_host(node_clock& clk, const std::vector<uint8_t>& f, double t_end, const setup_t& s)
+{
+	const double bt = rs485::byte_time_us;
+	for (size_t i = 0; i < f.size(); ++i) {
+		clk.set(t_end - (f.size() - 1 - i) * bt + uniform(0, s.max_isr_us));
+		receive(f[i], i < 4);
+	}
+}
+
+tx_t simulate_node(uint8_t id, uint8_t first, uint8_t num_slots, const setup_t& s, double parse_us)
+{
+	tx_t tx = {id, false, 0, 0, 0, false};
+
+	node_clock clk = {(uint64_t) uniform(1 << 16, 1 << 24), 1.0 + uniform(-s.max_drift, s.max_drift)};
+	clk.set(-2000);
+	eeprom_write_byte((uint8_t*) (uintptr_t) 23, id | 0x80);
+	usart::init(rs485::baudrate);
+	UCSR0B.value = 0; /* no tx in progress */
+	mock_core core;
+	com_t com(core);
+
+	/* some traffic before, with sync pairs in the payload (data_set_all
+	   starting at the next id). The last byte keeps the checksum from
+	   being FF for any id, in 8N1 it would form a sync pair with the next
+	   frame. */
+	std::vector<uint8_t> slices(1 + 6 * com_t::slice_len, 0xFF);
+	slices[0] = slices.size() - 1; /* N, in bytes */
+	slices.back() = 0x80;
+	send_host(clk, frame(0xB5, (id + 1) & 0x7F, slices), -200, s);
+	clk.set(-150);
+	com.step();
+
+	send_host(clk, frame(0xB0, first, {num_slots, s.slot_len, s.lead}), 0, s);
+
+	clk.set(parse_us);
+	const uint16_t missed = com.get_counter(com_t::missed_slots);
+	com.step();
+
+	if (not slottimer::busy()) {
+		CHECK(missed + 1 == com.get_counter(com_t::missed_slots));
+		return tx;
+	}
+
+	/* timer 2 compare B, fires when TCNT2 matches OCR2B */
+	while (TIMSK2.value & (1<<OCIE2B)) {
+		const uint64_t tick = avrsim::cycles() / 8;
+		uint64_t next = (tick & ~0xFFULL) | OCR2B.value;
+		if (next <= tick) next += 256;
+		avrsim::cycles() = next * 8 + (uint64_t) (uniform(0, s.max_isr_us) * 16);
+		TIMER2_COMPB_vect();
+	}
+	CHECK(usart::busy());
+
+	/* udre isr loads the first byte, the rest follows back to back */
+	tx.start = clk.global() + uniform(0, s.max_isr_us);
+	tx.len   = usart::tx_left;
+	const uint8_t* p = usart::tx_ptr;
+	std::vector<uint8_t> out(p, p + tx.len);
+	while (UCSR0B.value & (1<<UDRIE0)) USART_UDRE_vect();
+	USART_TX_vect();
+	tx.end  = tx.start + tx.len * rs485::byte_time_us + uniform(0, s.max_isr_us);
+	tx.sent = true;
+
+	checksum chk;
+	for (uint8_t b : out) chk.add(b);
+	tx.valid = chk.valid() and out.size() == frame_size and 0xC1 == out[2] and id == out[3];
+	return tx;
+}
+
+/* diag_response with the task statistics, and another node skipping it */
+void test_diag(void)
+{
+	task tasks[2] = {};
+	tasks[0].overruns = 3;  tasks[0].max_us = 120;
+	tasks[1].overruns = 0;  tasks[1].max_us = 0xFFFF; /* a sync pair */
+	setup_t s = {0, 0, 0, 0, 0};
+	node_clock clk = {0, 1.0};
+	clk.set(0);
+
+	eeprom_write_byte((uint8_t*) (uintptr_t) 23, 5 | 0x80);
+	usart::init(rs485::baudrate);
+	UCSR0B.value = 0;
+	std::vector<uint8_t> out;
+	{
+		mock_core core;
+		com_t com(core);
+		com.attach_tasks(tasks, 2);
+		send_host(clk, frame(0xA4, 5, {0x80}), 100, s);
+		com.step();
+		CHECK(usart::busy());
+		out.assign(usart::tx_ptr, usart::tx_ptr + usart::tx_left);
+		while (UCSR0B.value & (1<<UDRIE0)) USART_UDRE_vect();
+		USART_TX_vect();
+	}
+	const size_t n = 4 + 2 + 2 * com_t::num_counters + 4 * 2 + 1;
+	CHECK(n == out.size());
+	if (n == out.size()) {
+		CHECK(0xA5 == out[2] and 5 == out[3]);
+		CHECK(com_t::num_counters == out[4] and 2 == out[5]);
+		const uint8_t* t = &out[6 + 2 * com_t::num_counters];
+		CHECK(0 == t[0] and 3 == t[1] and 0 == t[2] and 120 == t[3]);
+		CHECK(0 == t[4] and 0 == t[5] and 0xFF == t[6] and 0xFF == t[7]);
+	}
+	CHECK(0 == tasks[0].overruns and 0 == tasks[1].max_us); /* reset */
+
+	/* node 6 eats the response, then answers its ping */
+	eeprom_write_byte((uint8_t*) (uintptr_t) 23, 6 | 0x80);
+	usart::init(rs485::baudrate);
+	UCSR0B.value = 0;
+	mock_core core;
+	com_t com(core);
+	std::vector<uint8_t> f = out;
+	const std::vector<uint8_t> ping = frame(0xE0, 6, {});
+	f.insert(f.end(), ping.begin(), ping.end());
+	for (size_t i = 0; i < f.size(); ++i) {
+		clk.set(1000 + 10 * i);
+		receive(f[i], i < 4 or (i >= out.size() and i < out.size() + 4));
+		com.step();
+	}
+	CHECK(usart::busy() and 0xE1 == usart::tx_ptr[2] and 6 == usart::tx_ptr[3]);
+	CHECK(0 == com.get_counter(com_t::dropped_frames));
+	CHECK(0 == com.get_counter(com_t::ignored_commands));
+	CHECK(2 == com.get_counter(com_t::processed_commands) + com.get_counter(com_t::other_frames));
+	while (UCSR0B.value & (1<<UDRIE0)) USART_UDRE_vect();
+	USART_TX_vect();
+}
+
+struct result_t {
+	unsigned sent, collisions;
+	double   min_gap, end, utilization;
+};
+
+result_t run(uint8_t first, uint16_t num_nodes, const setup_t& s, double parse_late = -1)
+{
+	std::vector<tx_t> txs;
+	for (uint16_t k = 0; k < num_nodes; ++k) {
+		const double parse_us = (0 == k and parse_late >= 0) ? parse_late : uniform(0, s.max_parse_us);
+		txs.push_back(simulate_node(first + k, first, num_nodes, s, parse_us));
+	}
+
+	result_t r = {0, 0, 1e9, 0, 0};
+	std::vector<tx_t> on_bus;
+	for (const tx_t& t : txs) {
+		if (not t.sent) continue;
+		CHECK(t.valid);
+		CHECK(t.start > 0);   /* not before the request ended */
+		on_bus.push_back(t);
+	}
+	std::sort(on_bus.begin(), on_bus.end(), [](const tx_t& a, const tx_t& b) { return a.start < b.start; });
+
+	double busy = 0;
+	for (size_t i = 0; i < on_bus.size(); ++i) {
+		busy += on_bus[i].len * rs485::byte_time_us;
+		if (i > 0) {
+			const double gap = on_bus[i].start - on_bus[i-1].end;
+			if (gap < r.min_gap) r.min_gap = gap;
+			if (gap <= 0) ++r.collisions;
+			CHECK(on_bus[i].id == on_bus[i-1].id + 1); /* in the order of the ids */
+		}
+		r.end = on_bus[i].end;
+	}
+	r.sent = on_bus.size();
+	r.utilization = r.end > 0 ? busy / r.end : 0;
+	return r;
+}
+
+int main()
+{
+	clock::init();
+	slottimer::init();
+
+	const setup_t typical = {
+		  900.0            /* max_parse_us, a task incl. a forced pixel frame */
+		, 4.0              /* max_isr_us */
+		, 100e-6           /* max_drift */
+		, frame_size       /* slot_len */
+		, 0                /* lead, default */
+	};
+
+	/* lead passed by a host, all tasks short (no pixels) */
+	const setup_t short_tasks = {
+		  200.0, 4.0, 100e-6, frame_size
+		, 25               /* lead, 250 us */
+	};
+
+	/* all ids, several times with new random parse delays, phases, drifts */
+	for (unsigned run_no = 0; run_no < 10; ++run_no) {
+		const result_t r = run(0, 128, typical);
+		CHECK(128 == r.sent);
+		CHECK(0 == r.collisions);
+		CHECK(r.min_gap > 0);
+		CHECK(r.utilization > 0.8);
+		if (0 == run_no)
+			printf("128 nodes: %u sent, min gap %.1f us, last done at %.0f us, utilization %.1f %%\n",
+			       r.sent, r.min_gap, r.end, 100 * r.utilization);
+	}
+
+	/* small groups need a short lead for a good utilization */
+	for (uint16_t n : {16, 20}) {
+		const result_t r = run(0, n, short_tasks);
+		CHECK(n == r.sent);
+		CHECK(0 == r.collisions);
+		CHECK(r.utilization > 0.8);
+		printf("%u nodes, lead 250 us: utilization %.1f %%\n", n, 100 * r.utilization);
+		const result_t d = run(0, n, typical);
+		CHECK(d.utilization < r.utilization);
+	}
+
+	test_diag();
+
+	/* a subset, ids 100..127 */
+	{
+		const result_t r = run(100, 28, typical);
+		CHECK(28 == r.sent);
+		CHECK(0 == r.collisions);
+	}
+
+	/* first node polls only after its slot has begun, it must keep silent */
+	{
+		const result_t r = run(0, 16, typical, com_t::default_lead_us + 100);
+		CHECK(15 == r.sent);
+		CHECK(0 == r.collisions);
+	}
+
+	/* slot too short for the response: nobody sends */
+	{
+		setup_t s = typical;
+		s.slot_len = frame_size - 1;
+		const result_t r = run(0, 8, s);
+		CHECK(0 == r.sent);
+	}
+
+#if JETPACK_RS485_MPCM
+	return test::result("slots (mpcm)");
+#else
+	return test::result("slots");
+#endif
+}
@@ -0,0 +1,484 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	Asynchronous TWI master with the rangefinder and the IMU on a mocked
+	I2C bus.
+
+	The TWI peripheral is modeled behind TWCR: a command written with
+	TWINT completes after the time it takes on the bus at the rate set
+	in TWBR and the TWSR prescaler, then TWINT and the status code in
+	TWSR are set. Every read of TWCR costs a few
+	cycles, as a polling loop does. Behind the bus are models of the
+	VL53L0X (interrupt status, result, interrupt clear, new samples at
+	its timing budget) and of the MPU-6050 (FIFO filled at 100 Hz).
+
+	Checks the rate set by twi::init, that a transaction takes as few
+	steps as its duration allows and still completes on a slower bus,
+	the time spent per step, nack, timeouts of a hung transaction and of
+	a stop condition that does not get out, both devices sharing the bus
+	over a second of task runs, and the deferred reconfiguration of the
+	rangefinder: its register writes, the final range timeout against
+	the library's and no library call after init.
+*/
+
+#include <vector>
+#include <string>
+#include <utility>
+#include "test.hpp"
+#include "rangef.h"
+#include "imu.hpp"
+
+using namespace jetpack;
+
+const uint64_t us = 16;                 /* cycles */
+const uint64_t t_poll  = 8;             /* one read of TWCR in a loop */
+
+/* SCL period in cycles, F_CPU / (16 + 2 * TWBR * 4^prescaler) */
+uint64_t t_scl(void) { return 16 + 2 * (uint64_t) TWBR.value * (1 << (2 * (TWSR.value & 3))); }
+uint64_t t_byte(void) { return 9 * t_scl(); }   /* 8 bits and ack */
+uint64_t t_cond(void) { return 2 * t_scl(); }   /* start or stop condition */
+
+struct device {
+	uint8_t address;
+	device(uint8_t a) : address(a) {}
+	virtual uint8_t read (uint8_t reg) = 0;
+	virtual void    write(uint8_t reg, uint8_t value) = 0;
+	virtual bool    increments(uint8_t) { return true; } /* register pointer after a byte */
+	virtual ~device() {}
+};
+
+/* continuous ranging, a sample every budget, kept until cleared;
+   registers shared with the library stub, writes to page 1 (0xFF = 1)
+   are only logged */
+struct vl53l0x_model : device {
+	uint64_t period   = 33000 * us;
+	uint64_t t_sample = 0;             /* of the next sample */
+	bool     ready    = false;
+	uint16_t distance = 500;
+	unsigned samples  = 0, read_samples = 0;
+	uint8_t  page     = 0;
+	std::vector<std::pair<uint8_t, uint8_t> > writes;
+
+	vl53l0x_model() : device(0x29) {}
+
+	uint8_t* regs(void) { return avrsim::vl53l0x_regs(); }
+	bool ranging(void) {
+		const uint8_t mode = regs()[VL53L0X::SYSRANGE_START];
+		return 0x02 == mode or 0x04 == mode;
+	}
+
+	void update(void) {
+		if (not ranging()) { t_sample = avrsim::cycles() + period; return; }
+		while (avrsim::cycles() >= t_sample) {
+			t_sample += period;
+			ready = true;
+			++samples;
+		}
+	}
+	uint8_t read(uint8_t reg) {
+		update();
+		switch(reg) {
+			case VL53L0X::RESULT_INTERRUPT_STATUS: return ready ? 0x07 : 0x00;
+			case VL53L0X::RESULT_RANGE_STATUS + 10: return (distance + samples) >> 8;
+			case VL53L0X::RESULT_RANGE_STATUS + 11: ++read_samples; return (distance + samples) & 0xff;
+			default: return regs()[reg];
+		}
+	}
+	void write(uint8_t reg, uint8_t value) {
+		if (VL53L0X::SYSTEM_INTERRUPT_CLEAR == reg and value) { ready = false; return; }
+		writes.push_back(std::make_pair(reg, value));
+		if (0xFF == reg) page = value;
+		else if (0 == page) { update(); regs()[reg] = value; }
+	}
+};
+
+/* samples into the fifo at 100 Hz, accel x = 1000 + n, others constant */
+struct mpu6050_model : device {
+	uint64_t t_next  = 0;
+	unsigned written = 0, fifo_read = 0;   /* bytes */
+	bool     enabled = false;
+
+	mpu6050_model() : device(0x68) {}
+
+	void update(void) {
+		if (not enabled) return;
+		while (avrsim::cycles() >= t_next) {
+			t_next  += 10000 * us;
+			written += IMU::sample_size;
+		}
+	}
+	uint16_t count(void) { update(); return written - fifo_read; }
+
+	uint8_t sample_byte(unsigned i) {
+		const unsigned n = i / IMU::sample_size, k = i % IMU::sample_size;
+		const int16_t v[6] = {(int16_t) (1000 + n), 2000, -3000, 10, -20, 30};
+		return (k & 1) ? v[k/2] & 0xff : (uint16_t) v[k/2] >> 8;
+	}
+	uint8_t read(uint8_t reg) {
+		switch(reg) {
+			case IMU::WHO_AM_I:     return 0x68;
+			case IMU::FIFO_COUNT_H: return count() >> 8;
+			case IMU::FIFO_COUNT_H + 1: return count() & 0xff;
+			case IMU::FIFO_R_W:     return count() ? sample_byte(fifo_read++) : 0;
+			default: return 0;
+		}
+	}
+	void write(uint8_t reg, uint8_t value) {
+		if (IMU::FIFO_EN == reg and value) { enabled = true; t_next = avrsim::cycles(); }
+		if (IMU::USER_CTRL == reg and (value & 0x04)) fifo_read = written; /* reset */
+	}
+	bool increments(uint8_t reg) { return IMU::FIFO_R_W != reg; }
+};
+
+/* TWI peripheral as master */
+struct bus_model {
+	enum op_t { none, start, stop, address, transmit, receive };
+
+	std::vector<device*> devices;
+	op_t     op          = none;
+	uint64_t t_done      = 0;
+	bool     addressing  = false;      /* next byte is SLA+R/W */
+	bool     reg_set     = false;
+	bool     ack         = false;
+	uint8_t  reg         = 0;
+	device*  dev         = nullptr;
+
+	bool     hang        = false;      /* a slave stretches the clock forever */
+	bool     stuck_stop  = false;      /* bus held low, stop does not get out */
+	unsigned commands    = 0, resets = 0;
+
+	bus_model() {
+		TWCR.on_write = [this](avrsim::reg8& r, uint8_t v) { command(r, v); };
+		TWCR.on_read  = [this](avrsim::reg8& r) { avrsim::advance(t_poll); complete(r); };
+	}
+	~bus_model() { TWCR.on_write = nullptr; TWCR.on_read = nullptr; }
+
+	device* find(uint8_t a) {
+		for (device* d : devices) if (d->address == a) return d;
+		return nullptr;
+	}
+
+	void command(avrsim::reg8& r, uint8_t v) {
+		if (not (v & (1<<TWEN))) { r.value = v; op = none; ++resets; return; }
+		if (not (v & (1<<TWINT))) { r.value = v; return; }
+		r.value = v & ~(1<<TWINT);          /* writing one clears the flag */
+		++commands;
+		const uint64_t now = avrsim::cycles();
+		const uint8_t st = TWSR.value & 0xF8;
+		if (v & (1<<TWSTA))      { op = start;    t_done = now + t_cond(); }
+		else if (v & (1<<TWSTO)) { op = stop;     t_done = now + t_cond(); }
+		else if (addressing)     { op = address;  t_done = now + t_byte(); }
+		else if (st == 0x40 or st == 0x50)
+		                         { op = receive;  t_done = now + t_byte(); ack = v & (1<<TWEA); }
+		else                     { op = transmit; t_done = now + t_byte(); }
+	}
+
+	void complete(avrsim::reg8& r) {
+		if (none == op or hang or avrsim::cycles() < t_done) return;
+		const uint8_t st = TWSR.value & 0xF8, prescaler = TWSR.value & 3;
+		uint8_t status = 0;
+		switch(op) {
+			case start:
+				status = (st == 0x08 or st == 0x18 or st == 0x28) ? 0x10 : 0x08;
+				addressing = true;
+				break;
+			case stop:
+				if (stuck_stop) return;
+				r.value &= ~(1<<TWSTO);
+				op = none;
+				TWSR.value = 0xF8 | prescaler;
+				return;
+			case address: {
+				const bool read = TWDR.value & 1;
+				addressing = false;
+				dev = find(TWDR.value >> 1);
+				if (not read) reg_set = false;
+				status = dev ? (read ? 0x40 : 0x18) : (read ? 0x48 : 0x20);
+				break;
+			}
+			case transmit:
+				if (not reg_set) { reg = TWDR.value; reg_set = true; }
+				else { dev->write(reg, TWDR.value); if (dev->increments(reg)) ++reg; }
+				status = 0x28;
+				break;
+			case receive:
+				TWDR.value = dev->read(reg);
+				if (dev->increments(reg)) ++reg;
+				status = ack ? 0x50 : 0x58;
+				break;
+			case none:
+				break;
+		}
+		op = none;
+		TWSR.value = status | prescaler;
+		r.value |= (1<<TWINT);
+	}
+};
+
+bus_model      bus;
+vl53l0x_model  ranger;
+mpu6050_model  mpu;
+
+/* as Sensors::step_i2c in core.hpp */
+void step_i2c(Rangefinder& rangef, IMU& imu)
+{
+	const uint16_t t_start = clock::now();
+	do {
+		twi::step(t_start);
+		rangef.step();
+		imu.step();
+	} while ((twi::busy() or twi::no_owner != twi::owner)
+	     and clock::since(t_start) < twi::step_budget_ticks);
+}
+
+/* steps until finished, returns their number, checks the time per step */
+unsigned run(uint64_t& max_step)
+{
+	unsigned steps = 0;
+	max_step = 0;
+	while (twi::busy() and steps < 1000) {
+		const uint64_t t0 = avrsim::cycles();
+		twi::step();
+		++steps;
+		if (avrsim::cycles() - t0 > max_step) max_step = avrsim::cycles() - t0;
+		avrsim::advance(200 * us);    /* the loop does other things */
+	}
+	twi::result();
+	return steps;
+}
+
+void test_transactions(void)
+{
+	uint8_t buf[4] = {0, 0, 0, 0};
+	uint64_t max_step;
+	const uint64_t budget = twi::step_budget_ticks * 8;
+
+	/* write of one byte, 4 events, ~73 us: a single step */
+	buf[0] = 0x01;
+	twi::write(0x29, VL53L0X::SYSTEM_INTERRUPT_CLEAR, buf, 1);
+	CHECK(1 == run(max_step));
+	CHECK(max_step < budget + 2 * us);
+
+	/* read of two bytes, 7 events, ~123 us: two steps */
+	mpu.written = 24;
+	twi::read(0x68, IMU::FIFO_COUNT_H, buf, 2);
+	const unsigned steps = run(max_step);
+	CHECK(2 == steps);
+	CHECK(max_step < budget + 2 * us);
+	CHECK(0 == buf[0] and 24 == buf[1]);
+	mpu.written = 0;
+
+	/* nobody at this address */
+	const uint16_t errors = twi::errors;
+	twi::read(0x30, 0x00, buf, 1);
+	while (twi::running == twi::state) twi::step();
+	CHECK(twi::failed == twi::result());
+	CHECK(errors + 1 == twi::errors);
+	while (twi::busy()) twi::step();
+}
+
+void test_rate(void)
+{
+	CHECK(12 == TWBR.value and 0 == (TWSR.value & 3));
+	CHECK(400000 == F_CPU / t_scl());
+	CHECK(((1<<PC4) | (1<<PC5)) == (PORTC.value & ((1<<PC4) | (1<<PC5))));
+	CHECK(0 == (DDRC.value & ((1<<PC4) | (1<<PC5))));
+	CHECK(TWCR.value & (1<<TWEN));
+
+	/* 100 kHz, a byte takes longer than a step: more steps, same bound */
+	TWBR.value = 72;
+	CHECK(100000 == F_CPU / t_scl());
+	uint8_t buf[2] = {0, 0};
+	uint64_t max_step;
+	mpu.written = 24;
+	twi::read(0x68, IMU::FIFO_COUNT_H, buf, 2);
+	const unsigned steps = run(max_step);
+	CHECK(steps > 2 and steps < 20);
+	CHECK(max_step < twi::step_budget_ticks * 8 + 2 * us);
+	CHECK(0 == buf[0] and 24 == buf[1]);
+	mpu.written = 0;
+	twi::init();
+}
+
+void test_timeouts(void)
+{
+	uint8_t buf[2];
+	const uint16_t errors = twi::errors;
+	const unsigned resets = bus.resets;
+
+	/* slave holds the clock */
+	bus.hang = true;
+	twi::read(0x68, IMU::WHO_AM_I, buf, 1);
+	const uint64_t t0 = avrsim::cycles();
+	while (twi::running == twi::state) { twi::step(); avrsim::advance(500 * us); }
+	CHECK(twi::failed == twi::result());
+	CHECK(avrsim::cycles() - t0 < 6000 * us);
+	CHECK(resets + 1 == bus.resets);
+	CHECK(errors + 1 == twi::errors);
+	bus.hang = false;
+
+	/* stop condition never gets out, busy() gives up as well */
+	bus.stuck_stop = true;
+	twi::read(0x68, IMU::WHO_AM_I, buf, 1);
+	while (twi::running == twi::state) twi::step();
+	CHECK(twi::done == twi::result());
+	const uint64_t t1 = avrsim::cycles();
+	unsigned polls = 0;
+	while (twi::busy()) { avrsim::advance(500 * us); ++polls; }
+	CHECK(polls > 5);
+	CHECK(avrsim::cycles() - t1 < 6000 * us);
+	CHECK(resets + 2 == bus.resets);
+	bus.stuck_stop = false;
+}
+
+/* i2c task every 500 us for a time, returns the longest run */
+uint64_t run_task(Rangefinder& rangef, IMU& imu, double seconds)
+{
+	uint64_t longest = 0;
+	const uint64_t end = avrsim::cycles() + (uint64_t) (seconds * 16e6);
+	while (avrsim::cycles() < end) {
+		const uint64_t t0 = avrsim::cycles();
+		step_i2c(rangef, imu);
+		const uint64_t d = avrsim::cycles() - t0;
+		if (d > longest) longest = d;
+		avrsim::cycles() = t0 + 500 * us;
+	}
+	return longest;
+}
+
+void test_sharing(Rangefinder& rangef, IMU& imu)
+{
+	const uint8_t  range_seq = rangef.seq, imu_seq = imu.seq;
+	const unsigned samples = ranger.samples, fifo_read = mpu.fifo_read;
+
+	const uint64_t longest = run_task(rangef, imu, 1.0);
+
+	/* every sample of both devices is read */
+	const uint8_t new_ranges = rangef.seq - range_seq;
+	CHECK(ranger.samples - samples - new_ranges <= 1);
+	CHECK(new_ranges >= 29);
+	CHECK(rangef.dx == ranger.distance + ranger.samples);
+	const uint8_t new_imu = imu.seq - imu_seq;      /* one per burst of 1..4 samples */
+	CHECK(new_imu >= 90);
+	CHECK(mpu.fifo_read - fifo_read >= 98 * IMU::sample_size);
+	CHECK(mpu.count() <= 2 * IMU::sample_size);     /* polled every 10 ms */
+	CHECK(2000 == imu.value[1] and -3000 == imu.value[2] and 30 == imu.value[5]);
+	CHECK(longest < twi::step_budget_ticks * 8 + t_byte());
+
+	printf("i2c: 1s of task runs, %u distances, %u imu bursts, longest run %.0f us\n",
+	       new_ranges, new_imu, longest / 16.0);
+}
+
+/* task runs until the job is done, returns the longest run */
+uint64_t reconfigure(Rangefinder& rangef, IMU& imu)
+{
+	uint64_t longest = 0;
+	unsigned runs = 0;
+	while (rangef.configuring() and runs < 200) {
+		const uint64_t t0 = avrsim::cycles();
+		step_i2c(rangef, imu);
+		if (avrsim::cycles() - t0 > longest) longest = avrsim::cycles() - t0;
+		avrsim::advance(500 * us);
+		++runs;
+	}
+	return longest;
+}
+
+void test_reconfigure(Rangefinder& rangef, IMU& imu)
+{
+	std::vector<avrsim::vl53l0x_call>& calls = avrsim::vl53l0x_calls();
+	calls.clear();
+
+	/* in the middle of a poll */
+	while (twi::client::rangefinder != twi::owner) {
+		step_i2c(rangef, imu);
+		avrsim::advance(500 * us);
+	}
+	const uint64_t t0 = avrsim::cycles();
+	CHECK(rangef.configure(50, 0));
+	CHECK(t0 == avrsim::cycles());     /* no bus access */
+	CHECK(rangef.configuring());
+	CHECK(50 == rangef.get_budget());
+	CHECK(not rangef.configure(10, 0));
+
+	/* register writes through the twi engine, no library calls */
+	ranger.writes.clear();
+	const uint64_t longest = reconfigure(rangef, imu);
+	CHECK(calls.empty());
+	CHECK(longest < twi::step_budget_ticks * 8 + t_byte());
+	CHECK(not rangef.configuring());
+	CHECK(twi::no_owner == twi::owner or twi::client::imu == twi::owner);
+	CHECK(ranger.ranging());
+
+	const uint8_t sv = VL53L0X::stop_variable;
+	const uint8_t hi = VL53L0X::FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI;
+	const std::vector<std::pair<uint8_t, uint8_t> > expected = {
+		  {0x00, 0x01}, {0xFF, 0x01}, {0x00, 0x00}, {0x91, 0x00}, {0x00, 0x01}, {0xFF, 0x00}  /* stop */
+		, {hi, ranger.regs()[hi]}, {hi + 1, ranger.regs()[hi + 1]}                           /* budget */
+		, {0x80, 0x01}, {0xFF, 0x01}, {0x00, 0x00}, {0x91, sv}, {0x00, 0x01}, {0xFF, 0x00}
+		, {0x80, 0x00}, {0x00, 0x02}                                                         /* start */
+	};
+	CHECK(expected == ranger.writes);
+
+	/* timeout as the library sets it, within one step of the encoding */
+	const uint16_t ours = (ranger.regs()[hi] << 8) | ranger.regs()[hi + 1];
+	VL53L0X lib;
+	lib.setMeasurementTimingBudget(50000);
+	const uint16_t ref = (ranger.regs()[hi] << 8) | ranger.regs()[hi + 1];
+	const int64_t diff = (int64_t) avrsim::vl53l0x_decode(ours) - (int64_t) avrsim::vl53l0x_decode(ref);
+	CHECK((ours >> 8) == (ref >> 8));
+	CHECK(std::abs(diff) <= (1 << (ref >> 8)));
+	calls.clear();
+
+	/* timed ranging, the period in oscillator cycles */
+	CHECK(rangef.configure(50, 100));
+	ranger.writes.clear();
+	reconfigure(rangef, imu);
+	CHECK(calls.empty());
+	const uint32_t p = 100UL * VL53L0X::osc_calibrate_val;
+	const size_t w = ranger.writes.size();
+	CHECK(20 == w);
+	if (20 == w) {
+		CHECK(std::make_pair((uint8_t) 0x04, (uint8_t) (p >> 24)) == ranger.writes[w - 5]);
+		CHECK(std::make_pair((uint8_t) 0x07, (uint8_t) (p & 0xff)) == ranger.writes[w - 2]);
+		CHECK(std::make_pair((uint8_t) 0x00, (uint8_t) 0x04)       == ranger.writes[w - 1]);
+	}
+	CHECK(ranger.ranging());
+	CHECK(rangef.configure(50, 0));
+	reconfigure(rangef, imu);
+
+	/* ranging and imu go on, at the new budget */
+	ranger.period = 50000 * us;
+	const uint8_t range_seq = rangef.seq, imu_seq = imu.seq;
+	run_task(rangef, imu, 1.0);
+	CHECK((uint8_t) (rangef.seq - range_seq) >= 19);
+	CHECK((uint8_t) (imu.seq - imu_seq) >= 90);
+}
+
+int main()
+{
+	clock::init();
+	twi::init();
+	bus.devices.push_back(&ranger);
+	bus.devices.push_back(&mpu);
+
+	test_transactions();
+	test_rate();
+	test_timeouts();
+
+	Rangefinder rangef;
+	IMU imu;
+	rangef.init();
+	imu.init();
+	CHECK(imu.is_present());
+	CHECK(mpu.enabled);
+
+	test_sharing(rangef, imu);
+	test_reconfigure(rangef, imu);
+
+	return test::result("twi");
+}
@@ -0,0 +1,224 @@
+/*---------------------------------+
+ | Jetpack Cognition Lab           |
+ | Sensorimotor Node Firmware      |
+ | October 2026                    |
+ +---------------------------------*/
+
+/*
+	USART driver on a mocked USART0.
+
+	The RX ISR is called with the byte in UDR0 and the status flags in
+	UCSR0A, as the hardware would do. Checks the ring (order, overflow,
+	error counters), the interrupt driven transmission, the arrival times
+	of sync pairs and, if built with JETPACK_RS485_MPCM=1, the address
+	filter. The ring is also run with the ISR on a second thread, to
+	stress the lock-free handover.
+*/
+
+#include <thread>
+#include <atomic>
+#include "test.hpp"
+#include "usart.hpp"
+
+using namespace jetpack;
+
+/* what the USART does on reception of one frame */
+void receive(uint8_t byte, bool addr = false, uint8_t errors = 0)
+{
+#if JETPACK_RS485_MPCM
+	if ((UCSR0A.value & (1<<MPCM0)) and not addr) return; /* data frame discarded in hardware */
+#endif
+	UCSR0A.value = (UCSR0A.value & ((1<<U2X0) | (1<<MPCM0))) | errors;
+	UCSR0B.value = addr ? (UCSR0B.value | (1<<RXB80)) : (UCSR0B.value & ~(1<<RXB80));
+	UDR0.value   = byte;
+	USART_RX_vect();
+}
+
+uint8_t drain(uint8_t* dst, uint8_t max)
+{
+	uint8_t n = 0, k;
+	while ((k = usart::read(dst + n, max - n)) > 0) n += k;
+	return n;
+}
+
+void test_ring(void)
+{
+	uint8_t buf[256];
+
+	for (uint8_t i = 0; i < 10; ++i) receive(i);
+	CHECK(10 == usart::available());
+	CHECK(4 == usart::read(buf, 4));
+	CHECK(0 == buf[0] and 3 == buf[3]);
+	CHECK(6 == drain(buf, 255));
+	CHECK(4 == buf[0] and 9 == buf[5]);
+	CHECK(0 == usart::available());
+
+	/* one slot stays free, the rest is dropped and counted */
+	const uint8_t overflows = usart::rx_ring_overflows;
+	for (uint16_t i = 0; i < usart::rx_size + 5; ++i) receive(i);
+	CHECK(usart::rx_size - 1 == usart::available());
+	CHECK(6 == (uint8_t) (usart::rx_ring_overflows - overflows));
+	CHECK(usart::rx_size - 1 == drain(buf, 255));
+	for (uint8_t i = 0; i < usart::rx_size - 1; ++i)
+		CHECK(i == buf[i]);
+
+	/* wraps around */
+	for (uint8_t i = 0; i < 100; ++i) receive(i);
+	CHECK(100 == drain(buf, 255));
+	CHECK(99 == buf[99]);
+}
+
+void test_errors(void)
+{
+	const uint8_t dor = usart::rx_overruns, fe = usart::rx_frame_errors;
+	receive(1, false, (1<<DOR0));
+	receive(2, false, (1<<FE0));
+	receive(3, false, (1<<DOR0) | (1<<FE0));
+	CHECK(2 == (uint8_t) (usart::rx_overruns - dor));
+	CHECK(2 == (uint8_t) (usart::rx_frame_errors - fe));
+	uint8_t buf[8];
+	CHECK(3 == drain(buf, 8)); /* bytes are kept, the parser's checksum decides */
+}
+
+void test_transmit(void)
+{
+	const uint8_t msg[5] = {0xFF, 0xFF, 0xE1, 0x07, 0x19};
+	uint8_t out[8];
+	uint8_t addr_bits = 0, n = 0;
+
+	usart::write(msg, sizeof(msg), 2);
+	CHECK(usart::busy());
+	while ((UCSR0B.value & (1<<UDRIE0)) and n < 8) {
+		USART_UDRE_vect();
+		if (UCSR0B.value & (1<<TXB80)) addr_bits |= 1<<n;
+		out[n++] = UDR0.value;
+	}
+	CHECK(5 == n);
+	for (uint8_t i = 0; i < 5; ++i) CHECK(msg[i] == out[i]);
+	CHECK(UCSR0B.value & (1<<TXCIE0));
+	CHECK(usart::busy());                   /* until the last bit left */
+	usart::tx_finished();
+	CHECK(not usart::busy());
+#if JETPACK_RS485_MPCM
+	CHECK(0x03 == addr_bits);
+#else
+	(void) addr_bits;
+#endif
+}
+
+#if JETPACK_RS485_MPCM
+void send_frame(uint8_t cmd, uint8_t id, uint8_t num_payload)
+{
+	receive(0xFF, true);
+	receive(0xFF, true);
+	receive(cmd,  true);
+	receive(id,   true);
+	for (uint8_t i = 0; i < num_payload; ++i) receive(0xA0 + i);
+}
+
+void test_address_filter(void)
+{
+	uint8_t buf[256];
+	usart::init(1000000);
+	usart::set_address(7);
+	drain(buf, 255);
+
+	send_frame(0x55, 3, 8);                 /* for someone else */
+	CHECK(4 == drain(buf, 255));            /* header only */
+
+	send_frame(0x55, 7, 8);                 /* ours */
+	CHECK(12 == drain(buf, 255));
+	CHECK(0xA7 == buf[11]);
+
+	send_frame(0xB5, 0, 20);                /* broadcast */
+	CHECK(24 == drain(buf, 255));
+
+	send_frame(0xC0, 9, 3);                 /* filter is set again on sync */
+	CHECK(4 == drain(buf, 255));
+}
+#endif
+
+/* arrival time of the sync pairs */
+void test_sync_stamps(void)
+{
+	uint8_t buf[256];
+	uint16_t t = 0;
+	usart::set_address(7);
+	drain(buf, 255);
+
+	/* frame start at a known time */
+	const uint8_t at = usart::position() + 1; /* second sync byte */
+	avrsim::cycles() = 16 * 1000;
+	receive(0xFF, true);
+	receive(0xFF, true);
+	const uint16_t t_sync = clock::now();
+	receive(0x60, true);
+	receive(7,    true);
+	CHECK(usart::sync_time(at, t) and t_sync == t);
+	CHECK(not usart::sync_time(at + 1, t));
+
+	/* payload of FF bytes, more FF pairs than there are stamps */
+	for (uint8_t i = 0; i < 3 * usart::num_stamps; ++i) {
+		avrsim::advance(160);
+		receive(0xFF);
+		receive(0xFF);
+	}
+#if JETPACK_RS485_MPCM
+	CHECK(usart::sync_time(at, t) and t_sync == t); /* data frames are no frame start */
+#else
+	CHECK(not usart::sync_time(at, t));             /* 8N1 cannot tell, the parser decides */
+#endif
+	drain(buf, 255);
+}
+
+/* ISR on its own thread, the main thread is the loop */
+void test_concurrent(void)
+{
+	const uint32_t num_bytes = 2000000;
+	std::atomic<bool> go(false);
+	uint8_t buf[256];
+	drain(buf, 255);
+	const uint8_t overflows = usart::rx_ring_overflows;
+
+	std::thread isr([&]() {
+		while (not go) std::this_thread::yield();
+		for (uint32_t i = 0; i < num_bytes; ++i) {
+			while (usart::available() >= usart::rx_size - 2) /* host paces, no drops */
+				std::this_thread::yield();
+			receive(i * 7);
+		}
+	});
+
+	go = true;
+	uint32_t count = 0, errors = 0;
+	while (count < num_bytes) {
+		const uint8_t n = usart::read(buf, 16);
+		if (0 == n) std::this_thread::yield();
+		for (uint8_t i = 0; i < n; ++i, ++count)
+			if (buf[i] != (uint8_t) (count * 7)) ++errors;
+	}
+	isr.join();
+	CHECK(0 == errors);
+	CHECK(overflows == usart::rx_ring_overflows);
+	CHECK(0 == usart::available());
+}
+
+int main()
+{
+	clock::init();
+	usart::init(1000000);
+#if JETPACK_RS485_MPCM
+	usart::set_mpcm(false); /* receive everything */
+#endif
+	test_ring();
+	test_errors();
+	test_transmit();
+	test_sync_stamps();
+#if JETPACK_RS485_MPCM
+	test_address_filter();
+	return test::result("usart (mpcm)");
+#else
+	test_concurrent();
+	return test::result("usart");
+#endif
+}